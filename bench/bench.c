@@ -0,0 +1,601 @@
+/* Host benchmark of cJSON on the recorded Surfline responses in tools/fixtures. For every document it times parsing,
+ * printing, minifying and the lookups the clock does, and counts what they allocate with CJSON_STATS. The figures
+ * are printed as a table and, with --json, written as a report that runs of different builds can be compared with.
+ * Numbers from the forecast are also printed and parsed on their own, against sprintf and strtod.
+ * See bench/CMakeLists.txt for the builds. */
+
+/* the number benchmarks call the static functions of cJSON, so it is compiled in here */
+#include "../main/cJSON.c"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifndef BENCH_FIXTURES
+#define BENCH_FIXTURES "../tools/fixtures"
+#endif
+
+/* copies of wave.json in the hourly document, about 1.7 MB like several days of hourly forecasts for all spots */
+#define HOURLY_COPIES 13
+/* how many forecast numbers the number benchmarks print and parse */
+#define NUMBER_COUNT 100000
+/* room for each of them as text */
+#define NUMBER_SIZE 32
+/* room for the interned keys of all documents */
+#define KEYS_SIZE 4096
+
+typedef struct
+{
+    const char *name;
+    char *json;
+    size_t length;
+    cJSON *root; /* parsed once for the print and lookup benchmarks */
+    size_t nodes;
+    char *scratch; /* length + 1 bytes for cJSON_Minify to work on */
+    unsigned long checksum; /* keeps the compiler from dropping lookups whose results are never used */
+} document;
+
+typedef struct
+{
+    double *values;
+    char *texts; /* NUMBER_SIZE bytes for each value, print_number writes them */
+    size_t count;
+    unsigned long checksum;
+} numbers;
+
+static double min_seconds = 0.5;
+static cJSON_Keys keys;
+static char keys_buffer[KEYS_SIZE];
+
+static double seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Seconds one call of run takes. Calls are repeated in batches of at least a fifth of min_seconds and the fastest
+ * of five batches counts, so a busy moment of the machine doesn't. With min_seconds 0 run is called once. */
+static double measure(void (*run)(void *data), void *data)
+{
+    unsigned long calls = 1;
+    unsigned long i = 0;
+    int batch = 0;
+    double elapsed = 0;
+    double best = 0;
+    clock_t start;
+
+    for (;;)
+    {
+        start = clock();
+        for (i = 0; i < calls; i++)
+        {
+            run(data);
+        }
+        elapsed = seconds_since(start);
+        if ((elapsed >= (min_seconds / 5)) || (calls >= (1UL << 30)))
+        {
+            break;
+        }
+        calls *= 2;
+    }
+    best = elapsed / calls;
+
+    for (batch = 1; (batch < 5) && (min_seconds > 0); batch++)
+    {
+        start = clock();
+        for (i = 0; i < calls; i++)
+        {
+            run(data);
+        }
+        elapsed = seconds_since(start) / calls;
+        if (elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+static char *read_file(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    char *content = NULL;
+    long size = 0;
+
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    if ((fseek(file, 0, SEEK_END) == 0) && ((size = ftell(file)) > 0) && (fseek(file, 0, SEEK_SET) == 0))
+    {
+        content = (char*)malloc((size_t)size + 1);
+    }
+    if ((content != NULL) && (fread(content, 1, (size_t)size, file) != (size_t)size))
+    {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+    if (content != NULL)
+    {
+        content[size] = '\0';
+        *length = (size_t)size;
+    }
+
+    return content;
+}
+
+/* an array of copies of json */
+static char *repeat_json(const char *json, size_t length, size_t copies, size_t *repeated_length)
+{
+    char *repeated = (char*)malloc((length + 1) * copies + 2);
+    size_t offset = 0;
+    size_t i = 0;
+
+    if (repeated == NULL)
+    {
+        return NULL;
+    }
+    repeated[offset++] = '[';
+    for (i = 0; i < copies; i++)
+    {
+        if (i > 0)
+        {
+            repeated[offset++] = ',';
+        }
+        memcpy(repeated + offset, json, length);
+        offset += length;
+    }
+    repeated[offset++] = ']';
+    repeated[offset] = '\0';
+    *repeated_length = offset;
+
+    return repeated;
+}
+
+/* the children of item, which only arrays and objects have: with CJSON_COMPACT_NODES the child shares its place
+ * with the value of strings */
+static const cJSON *children(const cJSON *item)
+{
+    return (cJSON_IsArray(item) || cJSON_IsObject(item)) ? cJSON_Child(item) : NULL;
+}
+
+static size_t count_nodes(const cJSON *item)
+{
+    size_t count = 0;
+
+    for (; item != NULL; item = item->next)
+    {
+        count += 1 + count_nodes(children(item));
+    }
+
+    return count;
+}
+
+static cJSON_bool load_document(document * const doc, const char *name, char *json, size_t length)
+{
+    if (json == NULL)
+    {
+        return false;
+    }
+    doc->name = name;
+    doc->json = json;
+    doc->length = length;
+    doc->root = cJSON_ParseWithLength(json, length);
+    doc->scratch = (char*)malloc(length + 1);
+    if ((doc->root == NULL) || (doc->scratch == NULL))
+    {
+        return false;
+    }
+    doc->nodes = count_nodes(doc->root);
+    doc->checksum = 0;
+
+    return true;
+}
+
+static void run_parse(void *data)
+{
+    document *doc = (document*)data;
+
+    cJSON_Delete(cJSON_ParseWithLength(doc->json, doc->length));
+}
+
+static void run_parse_keys(void *data)
+{
+    document *doc = (document*)data;
+
+    cJSON_Delete(cJSON_ParseWithKeys(&keys, doc->json, doc->length, NULL, false));
+}
+
+static void run_print(void *data)
+{
+    document *doc = (document*)data;
+
+    cJSON_free(cJSON_PrintUnformatted(doc->root));
+}
+
+static void run_minify(void *data)
+{
+    document *doc = (document*)data;
+
+    memcpy(doc->scratch, doc->json, doc->length + 1);
+    cJSON_Minify(doc->scratch);
+}
+
+static unsigned long look_up(const cJSON *item, const char *key)
+{
+    return (cJSON_GetObjectItemCaseSensitive(item, key) != NULL) ? 1 : 0;
+}
+
+/* What the clock reads from a forecast: a few members of every entry of the data array, by index. The hourly
+ * document is an array of forecasts. */
+static void run_lookup(void *data)
+{
+    document *doc = (document*)data;
+    const cJSON *forecasts = doc->root;
+    const cJSON *forecast = NULL;
+    const cJSON *entries = NULL;
+    const cJSON *entry = NULL;
+    int count = cJSON_IsArray(forecasts) ? cJSON_GetArraySize(forecasts) : 1;
+    int size = 0;
+    int i = 0;
+    int j = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        forecast = cJSON_IsArray(forecasts) ? cJSON_GetArrayItem(forecasts, i) : forecasts;
+        doc->checksum += look_up(cJSON_GetPath(forecast, "associated"), "utcOffset");
+        entries = children(cJSON_GetObjectItemCaseSensitive(forecast, "data"));
+        size = cJSON_GetArraySize(entries);
+        for (j = 0; j < size; j++)
+        {
+            entry = cJSON_GetArrayItem(entries, j);
+            doc->checksum += look_up(entry, "timestamp");
+            if (cJSON_HasObjectItem(entry, "am"))
+            {
+                doc->checksum += look_up(cJSON_GetObjectItemCaseSensitive(entry, "am"), "rating");
+                doc->checksum += look_up(cJSON_GetObjectItemCaseSensitive(entry, "am"), "maxHeight");
+            }
+            else
+            {
+                doc->checksum += look_up(cJSON_GetObjectItemCaseSensitive(entry, "surf"), "max");
+                doc->checksum += look_up(cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(entry, "swells"), 0), "height");
+            }
+        }
+    }
+}
+
+/* lookups one run_lookup does */
+static size_t count_lookups(document * const doc)
+{
+    doc->checksum = 0;
+    run_lookup(doc);
+
+    return doc->checksum;
+}
+
+static void collect_numbers(const cJSON *item, numbers * const collected, size_t limit)
+{
+    for (; (item != NULL) && (collected->count < limit); item = item->next)
+    {
+        if (cJSON_IsNumber(item))
+        {
+            collected->values[collected->count++] = cJSON_ValueDouble(item);
+        }
+        collect_numbers(children(item), collected, limit);
+    }
+}
+
+static void run_print_numbers(void *data)
+{
+    numbers *collected = (numbers*)data;
+    printbuffer output;
+    cJSON item;
+    size_t i = 0;
+
+    memset(&output, 0, sizeof(output));
+    memset(&item, 0, sizeof(item));
+    output.length = NUMBER_SIZE;
+    output.noalloc = true;
+    output.hooks = global_hooks;
+    item.type = cJSON_Number;
+    for (i = 0; i < collected->count; i++)
+    {
+        cJSON_ValueDouble(&item) = collected->values[i];
+        output.buffer = (unsigned char*)collected->texts + (i * NUMBER_SIZE);
+        output.offset = 0;
+        if (print_number(&item, &output))
+        {
+            collected->checksum += output.buffer[0];
+        }
+    }
+}
+
+/* print_number as it was before print_short_number: %1.15g and %1.17g if that doesn't read back close enough */
+static void run_print_numbers_sprintf(void *data)
+{
+    numbers *collected = (numbers*)data;
+    char buffer[32];
+    double test = 0;
+    size_t i = 0;
+
+    for (i = 0; i < collected->count; i++)
+    {
+        sprintf(buffer, "%1.15g", collected->values[i]);
+        if ((sscanf(buffer, "%lg", &test) != 1) || !compare_double(test, collected->values[i]))
+        {
+            sprintf(buffer, "%1.17g", collected->values[i]);
+        }
+        collected->checksum += (unsigned char)buffer[0];
+    }
+}
+
+/* parse_number with its shortcut for short numbers, on the texts run_print_numbers printed */
+static void run_parse_numbers(void *data)
+{
+    numbers *collected = (numbers*)data;
+    parse_buffer input;
+    cJSON item;
+    size_t i = 0;
+
+    memset(&input, 0, sizeof(input));
+    memset(&item, 0, sizeof(item));
+    input.hooks = global_hooks;
+    for (i = 0; i < collected->count; i++)
+    {
+        input.content = (const unsigned char*)collected->texts + (i * NUMBER_SIZE);
+        input.length = NUMBER_SIZE;
+        input.offset = 0;
+        if (parse_number(&item, &input))
+        {
+            collected->checksum += (unsigned long)cJSON_GetIntValue(&item);
+        }
+    }
+}
+
+/* strtod alone, which is what parse_number did for every number before */
+static void run_parse_numbers_strtod(void *data)
+{
+    numbers *collected = (numbers*)data;
+    size_t i = 0;
+
+    for (i = 0; i < collected->count; i++)
+    {
+        collected->checksum += (strtod(collected->texts + (i * NUMBER_SIZE), NULL) != 0) ? 1 : 0;
+    }
+}
+
+static cJSON *build_report(void)
+{
+    cJSON *report = cJSON_CreateObject();
+    cJSON *build = cJSON_AddObjectToObject(report, "build");
+
+    cJSON_AddNumberToObject(build, "word_bytes", (double)sizeof(unsigned long));
+    cJSON_AddNumberToObject(build, "item_bytes", (double)sizeof(cJSON));
+#ifdef CJSON_SCALAR_SCAN
+    cJSON_AddStringToObject(build, "scan", "scalar");
+#else
+    cJSON_AddStringToObject(build, "scan", "word");
+#endif
+#ifdef CJSON_COMPACT_NODES
+    cJSON_AddTrueToObject(build, "compact_nodes");
+#else
+    cJSON_AddFalseToObject(build, "compact_nodes");
+#endif
+#ifdef CJSON_OBJECT_INDEX
+    cJSON_AddTrueToObject(build, "object_index");
+#else
+    cJSON_AddFalseToObject(build, "object_index");
+#endif
+#ifdef CJSON_ARRAY_INDEX
+    cJSON_AddTrueToObject(build, "array_index");
+#else
+    cJSON_AddFalseToObject(build, "array_index");
+#endif
+    cJSON_AddNumberToObject(report, "min_seconds", min_seconds);
+    cJSON_AddArrayToObject(report, "documents");
+
+    return report;
+}
+
+/* Times one benchmark, counts what a single run of it allocates and adds both to the report. bytes is what MB/s is
+ * computed from and count how many of unit (node, lookup, number) a run handles, for ns per unit. 0 leaves the
+ * figure out. */
+static void bench_case(cJSON * const cases, const char *name, void (*run)(void *data), void *data, size_t bytes, size_t count, const char *unit)
+{
+    cJSON *result = cJSON_AddObjectToObject(cases, name);
+    cJSON_Stats stats;
+    char key[32];
+    double seconds = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    cJSON_InitKeys(&keys, keys_buffer, sizeof(keys_buffer));
+    cJSON_ResetStats();
+    run(data);
+    cJSON_GetStats(&stats);
+
+    seconds = measure(run, data);
+
+    printf("  %-12s %10.3f ms", name, seconds * 1e3);
+    cJSON_AddNumberToObject(result, "ms", seconds * 1e3);
+    if (bytes > 0)
+    {
+        printf(" %9.1f MB/s", (double)bytes / seconds / 1e6);
+        cJSON_AddNumberToObject(result, "bytes", (double)bytes);
+        cJSON_AddNumberToObject(result, "mb_per_s", (double)bytes / seconds / 1e6);
+    }
+    else
+    {
+        printf(" %14s", "");
+    }
+    if (count > 0)
+    {
+        printf(" %9.1f ns/%-6s", seconds * 1e9 / (double)count, unit);
+        sprintf(key, "%.20ss", unit);
+        cJSON_AddNumberToObject(result, key, (double)count);
+        sprintf(key, "ns_per_%.20s", unit);
+        cJSON_AddNumberToObject(result, key, seconds * 1e9 / (double)count);
+    }
+    else
+    {
+        printf(" %19s", "");
+    }
+    printf(" %7lu allocations %9lu bytes\n", (unsigned long)stats.allocations, (unsigned long)stats.allocated_bytes);
+
+    cJSON_AddNumberToObject(result, "allocations", (double)stats.allocations);
+    cJSON_AddNumberToObject(result, "reallocations", (double)stats.reallocations);
+    cJSON_AddNumberToObject(result, "allocated_bytes", (double)stats.allocated_bytes);
+    cJSON_AddNumberToObject(result, "items", (double)stats.items);
+}
+
+static void bench_document(cJSON * const report, document * const doc)
+{
+    cJSON *cases = cJSON_CreateObject();
+    char *printed = cJSON_PrintUnformatted(doc->root);
+    size_t printed_length = (printed != NULL) ? strlen(printed) : 0;
+
+    cJSON_free(printed);
+    printf("%s: %lu bytes, %lu nodes\n", doc->name, (unsigned long)doc->length, (unsigned long)doc->nodes);
+    cJSON_AddStringToObject(cases, "name", doc->name);
+    cJSON_AddNumberToObject(cases, "bytes", (double)doc->length);
+    cJSON_AddNumberToObject(cases, "nodes", (double)doc->nodes);
+
+    bench_case(cases, "parse", run_parse, doc, doc->length, doc->nodes, "node");
+    bench_case(cases, "parse_keys", run_parse_keys, doc, doc->length, doc->nodes, "node");
+    bench_case(cases, "print", run_print, doc, printed_length, doc->nodes, "node");
+    bench_case(cases, "minify", run_minify, doc, doc->length, 0, NULL);
+    bench_case(cases, "lookup", run_lookup, doc, 0, count_lookups(doc), "lookup");
+
+    cJSON_AddItemToArray(cJSON_GetObjectItemCaseSensitive(report, "documents"), cases);
+}
+
+static void bench_numbers(cJSON * const report, numbers * const collected)
+{
+    cJSON *cases = cJSON_AddObjectToObject(report, "numbers");
+
+    printf("%lu numbers from the hourly document\n", (unsigned long)collected->count);
+    cJSON_AddNumberToObject(cases, "count", (double)collected->count);
+    /* printing first leaves the texts for parsing */
+    bench_case(cases, "print", run_print_numbers, collected, 0, collected->count, "number");
+    bench_case(cases, "print_sprintf", run_print_numbers_sprintf, collected, 0, collected->count, "number");
+    bench_case(cases, "parse", run_parse_numbers, collected, 0, collected->count, "number");
+    bench_case(cases, "parse_strtod", run_parse_numbers_strtod, collected, 0, collected->count, "number");
+}
+
+static int usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--quick] [--time SECONDS] [--fixtures DIRECTORY] [--json FILE]\n", program);
+    fprintf(stderr, "  --quick      run everything once, to check that it works\n");
+    fprintf(stderr, "  --time       spend at least this long on every benchmark (default 0.5)\n");
+    fprintf(stderr, "  --fixtures   directory of the recorded responses (default %s)\n", BENCH_FIXTURES);
+    fprintf(stderr, "  --json       write the results to FILE\n");
+
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    const char *fixtures = BENCH_FIXTURES;
+    const char *report_path = NULL;
+    char path[1024];
+    document documents[3];
+    numbers collected;
+    cJSON *report = NULL;
+    char *printed = NULL;
+    char *json = NULL;
+    size_t length = 0;
+    int i = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            min_seconds = 0;
+        }
+        else if ((strcmp(argv[i], "--time") == 0) && ((i + 1) < argc))
+        {
+            min_seconds = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--fixtures") == 0) && ((i + 1) < argc))
+        {
+            fixtures = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--json") == 0) && ((i + 1) < argc))
+        {
+            report_path = argv[++i];
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+
+    /* the first spot the clock polls */
+    sprintf(path, "%.900s/conditions/58581a836630e24c44879014.json", fixtures);
+    json = read_file(path, &length);
+    if (!load_document(&documents[0], "conditions", json, length))
+    {
+        fprintf(stderr, "can't load %s\n", path);
+        return 1;
+    }
+    sprintf(path, "%.900s/wave.json", fixtures);
+    json = read_file(path, &length);
+    if (!load_document(&documents[1], "wave", json, length))
+    {
+        fprintf(stderr, "can't load %s\n", path);
+        return 1;
+    }
+    json = repeat_json(documents[1].json, documents[1].length, HOURLY_COPIES, &length);
+    if (!load_document(&documents[2], "hourly", json, length))
+    {
+        fprintf(stderr, "can't build the hourly document\n");
+        return 1;
+    }
+
+    collected.values = (double*)malloc(NUMBER_COUNT * sizeof(double));
+    collected.texts = (char*)calloc(NUMBER_COUNT, NUMBER_SIZE);
+    collected.count = 0;
+    collected.checksum = 0;
+    if ((collected.values == NULL) || (collected.texts == NULL))
+    {
+        return 1;
+    }
+    /* the numbers of the forecast over and over */
+    while (collected.count < NUMBER_COUNT)
+    {
+        collect_numbers(documents[2].root, &collected, NUMBER_COUNT);
+    }
+
+    report = build_report();
+    printf("cJSON %s, %s scan, %lu byte items\n", cJSON_Version(), cJSON_GetStringValue(cJSON_GetPath(report, "build.scan")), (unsigned long)sizeof(cJSON));
+    for (i = 0; i < (int)(sizeof(documents) / sizeof(documents[0])); i++)
+    {
+        bench_document(report, &documents[i]);
+    }
+    bench_numbers(report, &collected);
+
+    if (report_path != NULL)
+    {
+        FILE *file = fopen(report_path, "w");
+
+        printed = cJSON_Print(report);
+        if ((file == NULL) || (printed == NULL) || (fputs(printed, file) < 0) || (fputc('\n', file) == EOF))
+        {
+            fprintf(stderr, "can't write %s\n", report_path);
+            return 1;
+        }
+        fclose(file);
+        cJSON_free(printed);
+    }
+
+    cJSON_Delete(report);
+    for (i = 0; i < (int)(sizeof(documents) / sizeof(documents[0])); i++)
+    {
+        cJSON_Delete(documents[i].root);
+        free(documents[i].json);
+        free(documents[i].scratch);
+    }
+    free(collected.values);
+    free(collected.texts);
+
+    return 0;
+}
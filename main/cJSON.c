@@ -100,7 +100,7 @@ CJSON_PUBLIC(char *) cJSON_GetStringValue(const cJSON * const item)
         return NULL;
     }
 
-    return item->valuestring;
+    return cJSON_ValueString(item);
 }
 
 CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item) 
@@ -110,7 +110,40 @@ CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item)
         return (double) NAN;
     }
 
-    return item->valuedouble;
+    return cJSON_ValueDouble(item);
+}
+
+/* valueint of a number, using saturation in case of overflow */
+static int saturate_int(double number)
+{
+    if (number >= INT_MAX)
+    {
+        return INT_MAX;
+    }
+    if (number <= (double)INT_MIN)
+    {
+        return INT_MIN;
+    }
+
+    return (int)number;
+}
+
+CJSON_PUBLIC(int) cJSON_GetIntValue(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return 0;
+    }
+#ifdef CJSON_COMPACT_NODES
+    if (cJSON_IsNumber(item))
+    {
+        return saturate_int(cJSON_ValueDouble(item));
+    }
+
+    return cJSON_IsTrue(item) ? 1 : 0;
+#else
+    return item->valueint;
+#endif
 }
 
 /* This is a safeguard to prevent copy-pasters from using incompatible C and header files */
@@ -139,7 +172,8 @@ static int case_insensitive_strcmp(const unsigned char *string1, const unsigned
         return 0;
     }
 
-    for(; tolower(*string1) == tolower(*string2); (void)string1++, string2++)
+    /* only fold the case of bytes that differ */
+    for(; (*string1 == *string2) || (tolower(*string1) == tolower(*string2)); (void)string1++, string2++)
     {
         if (*string1 == '\0')
         {
@@ -150,6 +184,20 @@ static int case_insensitive_strcmp(const unsigned char *string1, const unsigned
     return tolower(*string1) - tolower(*string2);
 }
 
+/* hash of the length bytes of a key folded to lower case, so both kinds of lookups can use the same table */
+static size_t hash_key(const unsigned char *key, size_t length)
+{
+    /* FNV-1a */
+    size_t hash = (size_t)2166136261U;
+
+    for (; length > 0; (void)key++, length--)
+    {
+        hash = (hash ^ (size_t)tolower(*key)) * (size_t)16777619U;
+    }
+
+    return hash;
+}
+
 typedef struct internal_hooks
 {
     void *(CJSON_CDECL *allocate)(size_t size);
@@ -180,8 +228,131 @@ static void * CJSON_CDECL internal_realloc(void *pointer, size_t size)
 /* strlen of character literals resolved at compile time */
 #define static_strlen(string_literal) (sizeof(string_literal) - sizeof(""))
 
+#define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
+
+#ifdef CJSON_STATS
+static cJSON_Stats global_stats;
+/* the hooks in use are wrapped by ones that count their calls */
+static internal_hooks counted_hooks = { internal_malloc, internal_free, internal_realloc };
+
+static void * CJSON_CDECL counted_allocate(size_t size)
+{
+    void *pointer = counted_hooks.allocate(size);
+    if (pointer != NULL)
+    {
+        global_stats.allocations++;
+        global_stats.allocated_bytes += size;
+    }
+
+    return pointer;
+}
+
+static void CJSON_CDECL counted_deallocate(void *pointer)
+{
+    global_stats.deallocations++;
+    counted_hooks.deallocate(pointer);
+}
+
+static void * CJSON_CDECL counted_reallocate(void *pointer, size_t size)
+{
+    void *reallocated = counted_hooks.reallocate(pointer, size);
+    if (reallocated != NULL)
+    {
+        global_stats.reallocations++;
+        global_stats.allocated_bytes += size;
+    }
+
+    return reallocated;
+}
+
+static internal_hooks global_hooks = { counted_allocate, counted_deallocate, counted_reallocate };
+
+#define count_stat(counter) (global_stats.counter++)
+#else
 static internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc };
 
+#define count_stat(counter)
+#endif
+
+/* Deleted items are kept here for reuse, up to limit of them, instead of being freed. Like the hooks the pool is
+ * global, so it must only be enabled while one task at a time uses cJSON. */
+typedef struct
+{
+    cJSON *items; /* linked through next */
+    size_t count;
+    size_t limit;
+    size_t peak;
+    size_t hits;
+    size_t misses;
+} item_pool;
+
+static item_pool global_pool = { NULL, 0, 0, 0, 0, 0 };
+
+static cJSON *pool_allocate(const internal_hooks * const hooks)
+{
+    cJSON *item = global_pool.items;
+
+    if (item != NULL)
+    {
+        global_pool.items = item->next;
+        global_pool.count--;
+        global_pool.hits++;
+
+        return item;
+    }
+
+    if (global_pool.limit > 0)
+    {
+        global_pool.misses++;
+    }
+
+    return (cJSON*)hooks->allocate(sizeof(cJSON));
+}
+
+static void pool_release(cJSON * const item)
+{
+    if (global_pool.count >= global_pool.limit)
+    {
+        global_hooks.deallocate(item);
+        return;
+    }
+
+    item->next = global_pool.items;
+    global_pool.items = item;
+    global_pool.count++;
+    if (global_pool.count > global_pool.peak)
+    {
+        global_pool.peak = global_pool.count;
+    }
+}
+
+/* free pooled items until at most limit are left */
+static void pool_shrink(size_t limit)
+{
+    while (global_pool.count > limit)
+    {
+        cJSON *item = global_pool.items;
+        global_pool.items = item->next;
+        global_pool.count--;
+        global_hooks.deallocate(item);
+    }
+}
+
+static void set_global_hooks(const internal_hooks * const hooks)
+{
+    /* pooled items have to go back to the hooks they came from */
+    pool_shrink(0);
+
+#ifdef CJSON_STATS
+    counted_hooks = *hooks;
+    global_hooks.allocate = counted_allocate;
+    global_hooks.deallocate = counted_deallocate;
+    global_hooks.reallocate = (hooks->reallocate != NULL) ? counted_reallocate : NULL;
+#else
+    global_hooks = *hooks;
+#endif
+}
+
 static unsigned char* cJSON_strdup(const unsigned char* string, const internal_hooks * const hooks)
 {
     size_t length = 0;
@@ -205,71 +376,202 @@ static unsigned char* cJSON_strdup(const unsigned char* string, const internal_h
 
 CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
 {
+    internal_hooks new_hooks = { malloc, free, realloc };
+
     if (hooks == NULL)
     {
         /* Reset hooks */
-        global_hooks.allocate = malloc;
-        global_hooks.deallocate = free;
-        global_hooks.reallocate = realloc;
+        set_global_hooks(&new_hooks);
         return;
     }
 
-    global_hooks.allocate = malloc;
     if (hooks->malloc_fn != NULL)
     {
-        global_hooks.allocate = hooks->malloc_fn;
+        new_hooks.allocate = hooks->malloc_fn;
     }
 
-    global_hooks.deallocate = free;
     if (hooks->free_fn != NULL)
     {
-        global_hooks.deallocate = hooks->free_fn;
+        new_hooks.deallocate = hooks->free_fn;
     }
 
     /* use realloc only if both free and malloc are used */
-    global_hooks.reallocate = NULL;
-    if ((global_hooks.allocate == malloc) && (global_hooks.deallocate == free))
+    if ((new_hooks.allocate != malloc) || (new_hooks.deallocate != free))
+    {
+        new_hooks.reallocate = NULL;
+    }
+
+    set_global_hooks(&new_hooks);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_GetStats(cJSON_Stats * const stats)
+{
+#ifdef CJSON_STATS
+    if (stats != NULL)
+    {
+        *stats = global_stats;
+        return true;
+    }
+#else
+    (void)stats;
+#endif
+
+    return false;
+}
+
+CJSON_PUBLIC(void) cJSON_ResetStats(void)
+{
+#ifdef CJSON_STATS
+    memset(&global_stats, '\0', sizeof(global_stats));
+#endif
+}
+
+CJSON_PUBLIC(void) cJSON_SetItemPoolLimit(size_t limit)
+{
+    global_pool.limit = limit;
+    pool_shrink(limit);
+}
+
+CJSON_PUBLIC(void) cJSON_GetItemPoolStats(cJSON_PoolStats * const stats)
+{
+    if (stats == NULL)
     {
-        global_hooks.reallocate = realloc;
+        return;
     }
+
+    stats->items = global_pool.count;
+    stats->peak = global_pool.peak;
+    stats->hits = global_pool.hits;
+    stats->misses = global_pool.misses;
 }
 
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
-    cJSON* node = (cJSON*)hooks->allocate(sizeof(cJSON));
+    cJSON* node = pool_allocate(hooks);
     if (node)
     {
         memset(node, '\0', sizeof(cJSON));
+        count_stat(items);
     }
 
     return node;
 }
 
-/* Delete a cJSON structure. */
-CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
+#if defined(CJSON_OBJECT_INDEX) || defined(CJSON_ARRAY_INDEX)
+/* For an object an open addressing table over its children in the order of the list, for an array its children */
+typedef struct cJSON_Index
+{
+    size_t count; /* number of children */
+    size_t mask; /* objects: number of slots - 1, the number of slots is a power of 2 */
+    cJSON *slots[1];
+} cJSON_Index;
+
+/* marks objects and arrays that must not get an index because they live in an arena */
+static cJSON_Index no_index;
+/* remembers that an object or array was too small for an index until its children change */
+static cJSON_Index small_index;
+
+/* both marks have a count of 0, every real index has children */
+#define has_index(item) (((item)->index != NULL) && ((item)->index->count != 0))
+
+/* throw the index of an object or array away after its children changed */
+static void drop_index(cJSON * const item)
+{
+    if (has_index(item))
+    {
+        global_hooks.deallocate(item->index);
+    }
+    if (item->index != &no_index)
+    {
+        item->index = NULL;
+    }
+}
+#else
+#define drop_index(item)
+#endif
+
+#ifdef CJSON_COMPACT_NODES
+/* child, valuestring and valuedouble overlap, so check the type before reading one of them */
+#define has_children(item) (((item)->type & (cJSON_Array | cJSON_Object)) != 0)
+#define has_valuestring(item) (((item)->type & (cJSON_String | cJSON_Raw)) != 0)
+#define has_valuedouble(item) (((item)->type & cJSON_Number) != 0)
+#else
+#define has_children(item) true
+#define has_valuestring(item) true
+#define has_valuedouble(item) true
+#endif
+
+#ifdef CJSON_COMPACT_NODES
+/* there is no valueint, cJSON_GetIntValue works it out */
+#define set_valueint(item, number) ((void)0)
+#else
+#define set_valueint(item, number) ((item)->valueint = (number))
+#endif
+
+
+/* free memory that was allocated with the hooks of context, or with the global ones if there is none */
+static void context_deallocate(cJSON_Context * const context, void *pointer)
+{
+    if (context == NULL)
+    {
+        global_hooks.deallocate(pointer);
+        return;
+    }
+
+    context->stats.deallocations++;
+    context->hooks.free_fn(pointer);
+}
+
+/* Items of a context go back to its hooks without touching the pool, the others are released to the pool. */
+static void delete_items(cJSON *item, cJSON_Context * const context)
 {
     cJSON *next = NULL;
     while (item != NULL)
     {
-        next = item->next;
-        if (!(item->type & cJSON_IsReference) && (item->child != NULL))
+        if (!(item->type & cJSON_IsReference) && has_children(item) && (cJSON_Child(item) != NULL))
         {
-            cJSON_Delete(item->child);
+            /* instead of recursing, the first child takes the place of item, which follows it with the rest of its
+             * children, so the stack does not grow with the nesting */
+            cJSON *child = cJSON_Child(item);
+            cJSON_Child(item) = child->next;
+            child->next = item;
+            item = child;
+            continue;
         }
-        if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
+        next = item->next;
+        if (!(item->type & cJSON_IsReference) && has_valuestring(item) && (cJSON_ValueString(item) != NULL))
         {
-            global_hooks.deallocate(item->valuestring);
+            context_deallocate(context, cJSON_ValueString(item));
         }
         if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
         {
-            global_hooks.deallocate(item->string);
+            context_deallocate(context, item->string);
+        }
+        drop_index(item);
+        if (context != NULL)
+        {
+            context_deallocate(context, item);
+        }
+        else
+        {
+            pool_release(item);
         }
-        global_hooks.deallocate(item);
         item = next;
     }
 }
 
+/* Delete a cJSON structure. */
+CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
+{
+    delete_items(item, NULL);
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteWithContext(cJSON_Context * const context, cJSON *item)
+{
+    delete_items(item, context);
+}
+
 /* get the decimal point character of the current locale */
 static unsigned char get_decimal_point(void)
 {
@@ -281,6 +583,18 @@ static unsigned char get_decimal_point(void)
 #endif
 }
 
+/* State of an array or object that is parsed while a selector is active. Below a step that ends a path the selector
+ * is dropped and values below a step that selects nothing are skipped, so there are at most CJSON_SELECTOR_MAX_STEPS
+ * of them. */
+typedef struct
+{
+    size_t depth; /* parse_buffer.depth inside of the array or object */
+    size_t index; /* elements of an array seen so far */
+    size_t skipped; /* elements left out since the last one that was kept */
+    const cJSON_Selector *selector; /* of the level around it, restored at the closing bracket */
+    unsigned char step;
+} parse_level;
+
 typedef struct
 {
     const unsigned char *content;
@@ -288,6 +602,15 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    cJSON_Arena *arena; /* if not NULL the document is allocated from here instead of with hooks */
+    const cJSON_Selector *selector; /* if not NULL only what it selects below step is built */
+    unsigned char step;
+    cJSON_bool insitu; /* strings are unescaped in place and point into content */
+    size_t nesting_limit;
+    cJSON_Context *context; /* if not NULL hooks, stats and the error belong to it instead of being global */
+    parse_level *levels; /* CJSON_SELECTOR_MAX_STEPS of them if there is a selector */
+    size_t level_count;
+    cJSON_Keys *keys; /* if not NULL names of members are interned here */
 } parse_buffer;
 
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
@@ -298,127 +621,357 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
-/* Parse the input text to generate a number, and populate the result into item. */
-static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
-{
-    double number = 0;
-    unsigned char *after_end = NULL;
-    unsigned char number_c_string[64];
-    unsigned char decimal_point = get_decimal_point();
-    size_t i = 0;
+/* Scanning kernels. Runs of whitespace or string content are tested a machine word at a time (4 bytes on the ESP32,
+ * 8 on 64 bit hosts) from the first word boundary on, and only the word that ends the run is looked at byte by byte.
+ * Define CJSON_SCALAR_SCAN to scan one byte at a time. There are no SSE2 or AVX2 versions: the Xtensa core of the
+ * ESP32 has no vector unit, so they would only ever run in host builds, and nearly every string in the forecasts,
+ * keys included, is shorter than one 16 byte vector anyway. tests/scan_test.c checks the word kernels against the
+ * byte ones. */
+#ifndef CJSON_SCALAR_SCAN
+#if defined(__GNUC__)
+typedef unsigned long __attribute__((__may_alias__)) scan_word;
+#else
+typedef unsigned long scan_word;
+#endif
+#define SCAN_ONES (~0UL / 0xFF)
+#define SCAN_LOWS (SCAN_ONES * 0x7F)
+#define SCAN_HIGHS (SCAN_ONES * 0x80)
+/* high bit set in every byte of word that is zero */
+#define scan_zero_bytes(word) (~((((word) & SCAN_LOWS) + SCAN_LOWS) | (word) | SCAN_LOWS))
+/* high bit set in every byte of word that is greater than 32, i.e. not whitespace */
+#define scan_non_whitespace(word) (((((word) & SCAN_LOWS) + (SCAN_ONES * (0x7F - 32))) | (word)) & SCAN_HIGHS)
+/* high bit set in every byte of word that is a '"' or '\\' */
+#define scan_string_ends(word) (scan_zero_bytes((word) ^ (SCAN_ONES * '\"')) | scan_zero_bytes((word) ^ (SCAN_ONES * '\\')))
+#define scan_unaligned(pointer) (((size_t)(pointer) % sizeof(scan_word)) != 0)
+#endif
 
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+/* first byte from pointer that is not whitespace, or end, looking at one byte at a time */
+static const unsigned char *scan_whitespace_bytes(const unsigned char *pointer, const unsigned char * const end)
+{
+    for (; pointer < end; pointer++)
     {
-        return false;
+        if (*pointer > 32)
+        {
+            return pointer;
+        }
     }
 
-    /* copy the number into a temporary buffer and replace '.' with the decimal point
-     * of the current locale (for strtod)
-     * This also takes care of '\0' not necessarily being available for marking the end of the input */
-    for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, i); i++)
-    {
-        switch (buffer_at_offset(input_buffer)[i])
-        {
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case '+':
-            case '-':
-            case 'e':
-            case 'E':
-                number_c_string[i] = buffer_at_offset(input_buffer)[i];
-                break;
-
-            case '.':
-                number_c_string[i] = decimal_point;
-                break;
+    return end;
+}
 
-            default:
-                goto loop_end;
+/* first byte from pointer that is a '"' or '\\', or end, looking at one byte at a time */
+static const unsigned char *scan_string_bytes(const unsigned char *pointer, const unsigned char * const end)
+{
+    for (; pointer < end; pointer++)
+    {
+        if ((*pointer == '\"') || (*pointer == '\\'))
+        {
+            return pointer;
         }
     }
-loop_end:
-    number_c_string[i] = '\0';
 
-    number = strtod((const char*)number_c_string, (char**)&after_end);
-    if (number_c_string == after_end)
+    return end;
+}
+
+/* first byte from pointer that is not whitespace, or end */
+static const unsigned char *scan_whitespace(const unsigned char *pointer, const unsigned char * const end)
+{
+#ifndef CJSON_SCALAR_SCAN
+    for (; (pointer < end) && scan_unaligned(pointer); pointer++)
+    {
+        if (*pointer > 32)
+        {
+            return pointer;
+        }
+    }
+    for (; (size_t)(end - pointer) >= sizeof(scan_word); pointer += sizeof(scan_word))
     {
-        return false; /* parse_error */
+        if (scan_non_whitespace(*(const scan_word*)(const void*)pointer) != 0)
+        {
+            break;
+        }
     }
+#endif
 
-    item->valuedouble = number;
+    return scan_whitespace_bytes(pointer, end);
+}
 
-    /* use saturation in case of overflow */
-    if (number >= INT_MAX)
+/* first byte from pointer that is a '"' or '\\', or end */
+static const unsigned char *scan_string(const unsigned char *pointer, const unsigned char * const end)
+{
+#ifndef CJSON_SCALAR_SCAN
+    for (; (pointer < end) && scan_unaligned(pointer); pointer++)
     {
-        item->valueint = INT_MAX;
+        if ((*pointer == '\"') || (*pointer == '\\'))
+        {
+            return pointer;
+        }
     }
-    else if (number <= (double)INT_MIN)
+    for (; (size_t)(end - pointer) >= sizeof(scan_word); pointer += sizeof(scan_word))
     {
-        item->valueint = INT_MIN;
+        if (scan_string_ends(*(const scan_word*)(const void*)pointer) != 0)
+        {
+            break;
+        }
     }
-    else
+#endif
+
+    return scan_string_bytes(pointer, end);
+}
+
+/* everything in an arena is aligned for the most demanding member of cJSON */
+#define arena_align(size) (((size) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+
+static void *arena_allocate(cJSON_Arena * const arena, size_t size)
+{
+    unsigned char *pointer = NULL;
+
+    if ((arena->size - arena->used) < arena_align(size))
     {
-        item->valueint = (int)number;
+        return NULL;
     }
+    pointer = arena->buffer + arena->used;
+    arena->used += arena_align(size);
 
-    item->type = cJSON_Number;
+    return pointer;
+}
 
-    input_buffer->offset += (size_t)(after_end - number_c_string);
-    return true;
+/* allocate memory for the document that is being parsed */
+static void *parse_allocate(parse_buffer * const buffer, size_t size)
+{
+    void *pointer = NULL;
+
+    if (buffer->arena != NULL)
+    {
+        return arena_allocate(buffer->arena, size);
+    }
+
+    pointer = buffer->hooks.allocate(size);
+    if ((pointer != NULL) && (buffer->context != NULL))
+    {
+        buffer->context->stats.allocations++;
+        buffer->context->stats.allocated_bytes += size;
+    }
+
+    return pointer;
 }
 
-/* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
-CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
+/* give memory from parse_allocate back, the arena is rolled back as a whole when a parse fails */
+static void parse_deallocate(parse_buffer * const buffer, void *pointer)
 {
-    if (number >= INT_MAX)
+    if (buffer->arena != NULL)
     {
-        object->valueint = INT_MAX;
+        return;
     }
-    else if (number <= (double)INT_MIN)
+
+    if (buffer->context != NULL)
     {
-        object->valueint = INT_MIN;
+        context_deallocate(buffer->context, pointer);
     }
     else
     {
-        object->valueint = (int)number;
+        buffer->hooks.deallocate(pointer);
     }
-
-    return object->valuedouble = number;
 }
 
-CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
+static cJSON *parse_new_item(parse_buffer * const buffer)
 {
-    char *copy = NULL;
-    /* if object's type is not cJSON_String or is cJSON_IsReference, it should not set valuestring */
-    if (!(object->type & cJSON_String) || (object->type & cJSON_IsReference))
-    {
-        return NULL;
-    }
-    if (strlen(valuestring) <= strlen(object->valuestring))
+    cJSON *node = NULL;
+
+    if ((buffer->arena != NULL) || (buffer->context != NULL))
     {
-        strcpy(object->valuestring, valuestring);
-        return object->valuestring;
+        node = (cJSON*)parse_allocate(buffer, sizeof(cJSON));
     }
-    copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &global_hooks);
-    if (copy == NULL)
+    else
     {
-        return NULL;
+        node = pool_allocate(&buffer->hooks);
     }
-    if (object->valuestring != NULL)
+    if (node)
     {
-        cJSON_free(object->valuestring);
+        memset(node, '\0', sizeof(cJSON));
+        if (buffer->context != NULL)
+        {
+            buffer->context->stats.items++;
+        }
+        else
+        {
+            count_stat(items);
+        }
+#if defined(CJSON_OBJECT_INDEX) || defined(CJSON_ARRAY_INDEX)
+        if (buffer->arena != NULL)
+        {
+            /* nothing would ever free an index allocated with the hooks */
+            node->index = &no_index;
+        }
+#endif
     }
-    object->valuestring = copy;
 
-    return copy;
+    return node;
+}
+
+/* powers of ten that are exact in a double */
+static const double exact_powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+/* Integers and short decimals without exponent don't need strtod. With at most 15 digits both the digits and the
+ * power of ten are exact in a double, so the one division rounds to the same result as strtod would.
+ * Returns the length of the number or 0 if strtod has to parse it. */
+static size_t parse_short_number(const parse_buffer * const input_buffer, double * const number)
+{
+    const unsigned char *input = buffer_at_offset(input_buffer);
+    size_t length = 0;
+    size_t digits = 0;
+    size_t decimals = 0;
+    double mantissa = 0;
+
+    if (can_access_at_index(input_buffer, 0) && (input[0] == '-'))
+    {
+        length++;
+    }
+    for (; can_access_at_index(input_buffer, length) && (input[length] >= '0') && (input[length] <= '9'); length++)
+    {
+        mantissa = (mantissa * 10) + (input[length] - '0');
+        digits++;
+    }
+    if (can_access_at_index(input_buffer, length) && (input[length] == '.'))
+    {
+        for (length++; can_access_at_index(input_buffer, length) && (input[length] >= '0') && (input[length] <= '9'); length++)
+        {
+            mantissa = (mantissa * 10) + (input[length] - '0');
+            decimals++;
+        }
+        if (decimals == 0)
+        {
+            return 0;
+        }
+    }
+
+    if ((digits == 0) || ((digits + decimals) >= (sizeof(exact_powers_of_ten) / sizeof(exact_powers_of_ten[0]))))
+    {
+        return 0;
+    }
+    if (can_access_at_index(input_buffer, length) && ((input[length] == 'e') || (input[length] == 'E')))
+    {
+        return 0;
+    }
+
+    mantissa /= exact_powers_of_ten[decimals];
+    *number = (input[0] == '-') ? -mantissa : mantissa;
+
+    return length;
+}
+
+/* Parse the input text to generate a number, and populate the result into item. */
+static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
+{
+    double number = 0;
+    unsigned char *after_end = NULL;
+    unsigned char number_c_string[64];
+    unsigned char decimal_point = 0;
+    size_t length = 0;
+    size_t i = 0;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false;
+    }
+
+    length = parse_short_number(input_buffer, &number);
+    if (length == 0)
+    {
+        decimal_point = get_decimal_point();
+
+        /* copy the number into a temporary buffer and replace '.' with the decimal point
+         * of the current locale (for strtod)
+         * This also takes care of '\0' not necessarily being available for marking the end of the input */
+        for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, i); i++)
+        {
+            switch (buffer_at_offset(input_buffer)[i])
+            {
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9':
+                case '+':
+                case '-':
+                case 'e':
+                case 'E':
+                    number_c_string[i] = buffer_at_offset(input_buffer)[i];
+                    break;
+
+                case '.':
+                    number_c_string[i] = decimal_point;
+                    break;
+
+                default:
+                    goto loop_end;
+            }
+        }
+loop_end:
+        number_c_string[i] = '\0';
+
+        number = strtod((const char*)number_c_string, (char**)&after_end);
+        if (number_c_string == after_end)
+        {
+            return false; /* parse_error */
+        }
+        length = (size_t)(after_end - number_c_string);
+    }
+
+    cJSON_ValueDouble(item) = number;
+
+    set_valueint(item, saturate_int(number));
+
+    item->type = cJSON_Number;
+
+    input_buffer->offset += length;
+    return true;
+}
+
+/* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
+CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
+{
+    /* with CJSON_COMPACT_NODES valuedouble would overwrite the child or valuestring of anything but a number */
+    if (!has_valuedouble(object))
+    {
+        return number;
+    }
+
+    set_valueint(object, saturate_int(number));
+
+    return cJSON_ValueDouble(object) = number;
+}
+
+CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
+{
+    char *copy = NULL;
+    /* if object's type is not cJSON_String or is cJSON_IsReference, it should not set valuestring */
+    if (!(object->type & cJSON_String) || (object->type & cJSON_IsReference))
+    {
+        return NULL;
+    }
+    if (strlen(valuestring) <= strlen(cJSON_ValueString(object)))
+    {
+        strcpy(cJSON_ValueString(object), valuestring);
+        return cJSON_ValueString(object);
+    }
+    copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &global_hooks);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    if (cJSON_ValueString(object) != NULL)
+    {
+        cJSON_free(cJSON_ValueString(object));
+    }
+    cJSON_ValueString(object) = copy;
+
+    return copy;
 }
 
 typedef struct
@@ -430,8 +983,23 @@ typedef struct
     cJSON_bool noalloc;
     cJSON_bool format; /* is this print a formatted print */
     internal_hooks hooks;
+    cJSON_PrintSink sink; /* if not NULL buffer is a window that is handed to sink when it is full */
+    void *sink_data;
 } printbuffer;
 
+/* hand everything printed so far to the sink and start over at the beginning of the window */
+static cJSON_bool flush_sink(printbuffer * const p)
+{
+    if ((p->offset > 0) && !p->sink(p->sink_data, (const char*)p->buffer, p->offset))
+    {
+        return false;
+    }
+    p->offset = 0;
+    p->buffer[0] = '\0';
+
+    return true;
+}
+
 /* realloc printbuffer if necessary to have at least "needed" bytes more */
 static unsigned char* ensure(printbuffer * const p, size_t needed)
 {
@@ -461,6 +1029,17 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
         return p->buffer + p->offset;
     }
 
+    if (p->sink != NULL)
+    {
+        needed -= p->offset;
+        if ((needed > p->length) || !flush_sink(p))
+        {
+            return NULL;
+        }
+
+        return p->buffer;
+    }
+
     if (p->noalloc) {
         return NULL;
     }
@@ -538,16 +1117,119 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
+/* Print numbers from 1e-4 up to 1e15 that are exact with the fewest decimals without sprintf. Like in
+ * parse_short_number the digits and the power of ten are exact in a double, so if dividing them gives number back,
+ * so does parsing the output. Returns the length printed into buffer or 0 if sprintf has to print number. */
+static int print_short_number(double number, unsigned char * const buffer)
+{
+    static const double positive_zero = 0;
+    double magnitude = (number < 0) ? -number : number;
+    double scaled = 0;
+    double low = 0;
+    unsigned long high_digits = 0;
+    unsigned long low_digits = 0;
+    unsigned char digits[20];
+    size_t count = 0;
+    size_t decimals = 0;
+    int length = 0;
+
+    if (number == 0)
+    {
+        /* leave -0 to sprintf */
+        if (memcmp(&number, &positive_zero, sizeof(number)) != 0)
+        {
+            return 0;
+        }
+        buffer[length++] = '0';
+        buffer[length] = '\0';
+        return length;
+    }
+    if ((magnitude < 1e-4) || (magnitude >= 1e15))
+    {
+        return 0;
+    }
+
+    for (decimals = 0; decimals < (sizeof(exact_powers_of_ten) / sizeof(exact_powers_of_ten[0])); decimals++)
+    {
+        scaled = floor((magnitude * exact_powers_of_ten[decimals]) + 0.5);
+        if (scaled >= 9007199254740992.0) /* 2^53 */
+        {
+            return 0;
+        }
+        if ((scaled / exact_powers_of_ten[decimals]) == magnitude)
+        {
+            break;
+        }
+    }
+    if (decimals == (sizeof(exact_powers_of_ten) / sizeof(exact_powers_of_ten[0])))
+    {
+        return 0;
+    }
+
+    /* split the digits in two, so they can be printed with integer arithmetic */
+    high_digits = (unsigned long)floor(scaled / 1e9);
+    low = scaled - ((double)high_digits * 1e9);
+    if (low < 0)
+    {
+        high_digits--;
+        low += 1e9;
+    }
+    else if (low >= 1e9)
+    {
+        high_digits++;
+        low -= 1e9;
+    }
+    low_digits = (unsigned long)low;
+
+    /* collect the digits from the last one */
+    for (count = 0; count < 9; count++)
+    {
+        digits[count] = (unsigned char)('0' + (low_digits % 10));
+        low_digits /= 10;
+    }
+    for (; high_digits > 0; count++)
+    {
+        digits[count] = (unsigned char)('0' + (high_digits % 10));
+        high_digits /= 10;
+    }
+    while (count <= decimals)
+    {
+        digits[count++] = '0';
+    }
+    /* drop leading zeros, but keep the one in front of the decimal point */
+    while ((count > (decimals + 1)) && (digits[count - 1] == '0'))
+    {
+        count--;
+    }
+
+    if (number < 0)
+    {
+        buffer[length++] = '-';
+    }
+    while (count > 0)
+    {
+        buffer[length++] = digits[--count];
+        if ((count == decimals) && (decimals > 0))
+        {
+            buffer[length++] = '.';
+        }
+    }
+    buffer[length] = '\0';
+
+    return length;
+}
+
 /* Render the number nicely from the given item into a string. */
 static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
 {
     unsigned char *output_pointer = NULL;
-    double d = item->valuedouble;
+    double d = cJSON_ValueDouble(item);
     int length = 0;
     size_t i = 0;
     unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
     unsigned char decimal_point = get_decimal_point();
     double test = 0.0;
+    int precision = 0;
 
     if (output_buffer == NULL)
     {
@@ -561,14 +1243,18 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     }
     else
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char*)number_buffer, "%1.15g", d);
+        /* integers and short decimals don't need sprintf */
+        length = print_short_number(d, number_buffer);
 
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || !compare_double((double)test, d))
+        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits, and more until the
+         * original double can be recovered exactly */
+        for (precision = 15; (length == 0) && (precision <= 17); precision++)
         {
-            /* If not, print with 17 decimal places of precision */
-            length = sprintf((char*)number_buffer, "%1.17g", d);
+            length = sprintf((char*)number_buffer, "%1.*g", precision, d);
+            if ((precision < 17) && ((sscanf((char*)number_buffer, "%lg", &test) != 1) || (test != d)))
+            {
+                length = 0;
+            }
         }
     }
 
@@ -762,6 +1448,8 @@ fail:
     return 0;
 }
 
+static void* cast_away_const(const void* string);
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -769,6 +1457,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
     unsigned char *output_pointer = NULL;
     unsigned char *output = NULL;
+    size_t skipped_bytes = 0;
 
     /* not a string */
     if (buffer_at_offset(input_buffer)[0] != '\"')
@@ -779,11 +1468,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
-        size_t skipped_bytes = 0;
         while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
         {
+            input_end = scan_string(input_end, input_buffer->content + input_buffer->length);
             /* is escape sequence */
-            if (input_end[0] == '\\')
+            if (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (input_end[0] == '\\'))
             {
                 if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
                 {
@@ -791,9 +1480,8 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
                     goto fail;
                 }
                 skipped_bytes++;
-                input_end++;
+                input_end += 2;
             }
-            input_end++;
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -802,7 +1490,15 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (input_buffer->insitu)
+        {
+            /* unescaping never makes a string longer, so it fits over its own input up to the closing quote */
+            output = (unsigned char*)cast_away_const(input_pointer);
+        }
+        else
+        {
+            output = (unsigned char*)parse_allocate(input_buffer, allocation_length + sizeof(""));
+        }
         if (output == NULL)
         {
             goto fail; /* allocation failure */
@@ -810,6 +1506,16 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     }
 
     output_pointer = output;
+    /* without escape sequences the string is copied as it is, in place it already is where it belongs */
+    if (skipped_bytes == 0)
+    {
+        if (output != input_pointer)
+        {
+            memcpy(output, input_pointer, (size_t)(input_end - input_pointer));
+        }
+        output_pointer += input_end - input_pointer;
+        input_pointer = input_end;
+    }
     /* loop through the string literal */
     while (input_pointer < input_end)
     {
@@ -869,8 +1575,14 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     /* zero terminate the output */
     *output_pointer = '\0';
 
-    item->type = cJSON_String;
-    item->valuestring = (char*)output;
+    /* escape sequences make the string shorter than estimated, hand the rest back to the arena */
+    if ((input_buffer->arena != NULL) && !input_buffer->insitu)
+    {
+        input_buffer->arena->used = (size_t)(output - input_buffer->arena->buffer) + arena_align((size_t)(output_pointer - output) + sizeof(""));
+    }
+
+    item->type = input_buffer->insitu ? (cJSON_String | cJSON_IsReference) : cJSON_String;
+    cJSON_ValueString(item) = (char*)output;
 
     input_buffer->offset = (size_t) (input_end - input_buffer->content);
     input_buffer->offset++;
@@ -878,9 +1590,9 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && !input_buffer->insitu)
     {
-        input_buffer->hooks.deallocate(output);
+        parse_deallocate(input_buffer, output);
     }
 
     if (input_pointer != NULL)
@@ -891,12 +1603,105 @@ fail:
     return false;
 }
 
+/* write the escaped characters from input up to end to output, returns the end of the output */
+static unsigned char *escape_string(const unsigned char *input_pointer, const unsigned char * const end, unsigned char *output_pointer)
+{
+    for (; input_pointer < end; (void)input_pointer++, output_pointer++)
+    {
+        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        {
+            /* normal character, copy */
+            *output_pointer = *input_pointer;
+        }
+        else
+        {
+            /* character needs to be escaped */
+            *output_pointer++ = '\\';
+            switch (*input_pointer)
+            {
+                case '\\':
+                    *output_pointer = '\\';
+                    break;
+                case '\"':
+                    *output_pointer = '\"';
+                    break;
+                case '\b':
+                    *output_pointer = 'b';
+                    break;
+                case '\f':
+                    *output_pointer = 'f';
+                    break;
+                case '\n':
+                    *output_pointer = 'n';
+                    break;
+                case '\r':
+                    *output_pointer = 'r';
+                    break;
+                case '\t':
+                    *output_pointer = 't';
+                    break;
+                default:
+                    /* escape and print as unicode codepoint */
+                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
+                    output_pointer += 4;
+                    break;
+            }
+        }
+    }
+
+    return output_pointer;
+}
+
+/* print a string that is longer than the window of a sink, escaping as much of it at a time as fits */
+static cJSON_bool print_string_pieces(const unsigned char *input, printbuffer * const output_buffer)
+{
+    /* an escaped character takes up to six bytes */
+    const size_t piece_length = (output_buffer->length - 1) / 6;
+    size_t length = strlen((const char*)input);
+    unsigned char *output = NULL;
+
+    if (piece_length == 0)
+    {
+        return false;
+    }
+
+    output = ensure(output_buffer, 1);
+    if (output == NULL)
+    {
+        return false;
+    }
+    output[0] = '\"';
+    output_buffer->offset++;
+
+    while (length > 0)
+    {
+        const size_t piece = cjson_min(length, piece_length);
+        output = ensure(output_buffer, piece * 6);
+        if (output == NULL)
+        {
+            return false;
+        }
+        output_buffer->offset += (size_t)(escape_string(input, input + piece, output) - output);
+        input += piece;
+        length -= piece;
+    }
+
+    output = ensure(output_buffer, 1);
+    if (output == NULL)
+    {
+        return false;
+    }
+    output[0] = '\"';
+    output[1] = '\0';
+
+    return true;
+}
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
     const unsigned char *input_pointer = NULL;
     unsigned char *output = NULL;
-    unsigned char *output_pointer = NULL;
     size_t output_length = 0;
     /* numbers of additional characters needed for escaping */
     size_t escape_characters = 0;
@@ -945,6 +1750,12 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     }
     output_length = (size_t)(input_pointer - input) + escape_characters;
 
+    /* ensure() needs one byte more than it is asked for */
+    if ((output_buffer->sink != NULL) && ((output_length + sizeof("\"\"")) >= output_buffer->length))
+    {
+        return print_string_pieces(input, output_buffer);
+    }
+
     output = ensure(output_buffer, output_length + sizeof("\"\""));
     if (output == NULL)
     {
@@ -963,50 +1774,7 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     }
 
     output[0] = '\"';
-    output_pointer = output + 1;
-    /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
-    {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
-        {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
-        }
-        else
-        {
-            /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer)
-            {
-                case '\\':
-                    *output_pointer = '\\';
-                    break;
-                case '\"':
-                    *output_pointer = '\"';
-                    break;
-                case '\b':
-                    *output_pointer = 'b';
-                    break;
-                case '\f':
-                    *output_pointer = 'f';
-                    break;
-                case '\n':
-                    *output_pointer = 'n';
-                    break;
-                case '\r':
-                    *output_pointer = 'r';
-                    break;
-                case '\t':
-                    *output_pointer = 't';
-                    break;
-                default:
-                    /* escape and print as unicode codepoint */
-                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
-                    output_pointer += 4;
-                    break;
-            }
-        }
-    }
+    escape_string(input, input_pointer, output + 1);
     output[output_length + 1] = '\"';
     output[output_length + 2] = '\0';
 
@@ -1016,16 +1784,12 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
 /* Invoke print_string_ptr (which is useful) on an item. */
 static cJSON_bool print_string(const cJSON * const item, printbuffer * const p)
 {
-    return print_string_ptr((unsigned char*)item->valuestring, p);
+    return print_string_ptr((unsigned char*)cJSON_ValueString(item), p);
 }
 
 /* Predeclare these prototypes. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
 static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer);
 
 /* Utility to jump whitespace and cr/lf */
 static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
@@ -1040,9 +1804,9 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
         return buffer;
     }
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    if (buffer_at_offset(buffer)[0] <= 32)
     {
-       buffer->offset++;
+        buffer->offset = (size_t)(scan_whitespace(buffer_at_offset(buffer), buffer->content + buffer->length) - buffer->content);
     }
 
     if (buffer->offset == buffer->length)
@@ -1084,15 +1848,25 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
     return cJSON_ParseWithLengthOpts(value, buffer_length, return_parse_end, require_null_terminated);
 }
 
-/* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+/* Parse an object - create a new root, and populate. The arena, selector, insitu and context options are taken from
+ * buffer. */
+static cJSON *parse_document(parse_buffer buffer, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    cJSON_Arena * const arena = buffer.arena;
+    cJSON_Context * const context = buffer.context;
     cJSON *item = NULL;
+    size_t arena_used = (arena != NULL) ? arena->used : 0;
 
     /* reset error position */
-    global_error.json = NULL;
-    global_error.position = 0;
+    if (context != NULL)
+    {
+        context->error = NULL;
+    }
+    else
+    {
+        global_error.json = NULL;
+        global_error.position = 0;
+    }
 
     if (value == NULL || 0 == buffer_length)
     {
@@ -1102,9 +1876,25 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.content = (const unsigned char*)value;
     buffer.length = buffer_length; 
     buffer.offset = 0;
-    buffer.hooks = global_hooks;
+    if (context != NULL)
+    {
+        buffer.hooks.allocate = context->hooks.malloc_fn;
+        buffer.hooks.deallocate = context->hooks.free_fn;
+        buffer.hooks.reallocate = NULL;
+        buffer.nesting_limit = context->nesting_limit;
+    }
+    else
+    {
+        buffer.hooks = global_hooks;
+        buffer.nesting_limit = CJSON_NESTING_LIMIT;
+    }
+    /* a path that selects the root keeps everything */
+    if ((buffer.selector != NULL) && (buffer.selector->steps[0].ends != 0))
+    {
+        buffer.selector = NULL;
+    }
 
-    item = cJSON_New_Item(&global_hooks);
+    item = parse_new_item(&buffer);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1133,9 +1923,13 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     return item;
 
 fail:
-    if (item != NULL)
+    if (arena != NULL)
+    {
+        arena->used = arena_used;
+    }
+    else if (item != NULL)
     {
-        cJSON_Delete(item);
+        delete_items(item, context);
     }
 
     if (value != NULL)
@@ -1158,12 +1952,26 @@ fail:
             *return_parse_end = (const char*)local_error.json + local_error.position;
         }
 
-        global_error = local_error;
+        if (context != NULL)
+        {
+            context->error = (const char*)local_error.json + local_error.position;
+        }
+        else
+        {
+            global_error = local_error;
+        }
     }
 
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
+
+    return parse_document(buffer, value, buffer_length, return_parse_end, require_null_terminated);
+}
+
 /* Default options for cJSON_Parse */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
 {
@@ -1175,215 +1983,1004 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
     return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
 }
 
-#define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
-
-static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena * const arena, void *buffer, size_t size)
 {
-    static const size_t default_buffer_size = 256;
-    printbuffer buffer[1];
-    unsigned char *printed = NULL;
-
-    memset(buffer, 0, sizeof(buffer));
-
-    /* create buffer */
-    buffer->buffer = (unsigned char*) hooks->allocate(default_buffer_size);
-    buffer->length = default_buffer_size;
-    buffer->format = format;
-    buffer->hooks = *hooks;
-    if (buffer->buffer == NULL)
+    if (arena == NULL)
     {
-        goto fail;
+        return;
     }
 
-    /* print the value */
-    if (!print_value(item, buffer))
-    {
-        goto fail;
-    }
-    update_offset(buffer);
+    arena->buffer = (unsigned char*)buffer;
+    arena->size = (buffer != NULL) ? size : 0;
+    arena->used = 0;
 
-    /* check if reallocate is available */
-    if (hooks->reallocate != NULL)
+    /* start on an aligned address, like malloc would */
+    while ((arena->size > 0) && (((size_t)(arena->buffer + arena->used) % sizeof(double)) != 0))
     {
-        printed = (unsigned char*) hooks->reallocate(buffer->buffer, buffer->offset + 1);
-        if (printed == NULL) {
-            goto fail;
-        }
-        buffer->buffer = NULL;
+        arena->used++;
+        arena->size--;
     }
-    else /* otherwise copy the JSON over to a new buffer */
-    {
-        printed = (unsigned char*) hooks->allocate(buffer->offset + 1);
-        if (printed == NULL)
-        {
-            goto fail;
-        }
-        memcpy(printed, buffer->buffer, cjson_min(buffer->length, buffer->offset + 1));
-        printed[buffer->offset] = '\0'; /* just to be sure */
+    arena->buffer += arena->used;
+    arena->used = 0;
+}
 
-        /* free the buffer */
-        hooks->deallocate(buffer->buffer);
+CJSON_PUBLIC(void) cJSON_ResetArena(cJSON_Arena * const arena)
+{
+    if (arena != NULL)
+    {
+        arena->used = 0;
     }
+}
 
-    return printed;
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(cJSON_Arena * const arena, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
 
-fail:
-    if (buffer->buffer != NULL)
+    if (arena == NULL)
     {
-        hooks->deallocate(buffer->buffer);
+        return NULL;
     }
 
-    if (printed != NULL)
+    buffer.arena = arena;
+    return parse_document(buffer, value, buffer_length, return_parse_end, require_null_terminated);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseSelected(const cJSON_Selector * const selector, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
+    parse_level levels[CJSON_SELECTOR_MAX_STEPS];
+
+    if (selector == NULL)
     {
-        hooks->deallocate(printed);
+        return NULL;
     }
 
-    return NULL;
+    buffer.selector = selector;
+    buffer.levels = levels;
+    return parse_document(buffer, value, buffer_length, return_parse_end, require_null_terminated);
 }
 
-/* Render a cJSON item/entity/structure to text. */
-CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item)
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
 {
-    return (char*)print(item, true, &global_hooks);
-}
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
 
-CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
-{
-    return (char*)print(item, false, &global_hooks);
+    buffer.insitu = true;
+    return parse_document(buffer, value, buffer_length, return_parse_end, require_null_terminated);
 }
 
-CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
+/* find the key of length bytes in keys or add it, returns NULL if it is not there and doesn't fit */
+static const char *intern_key(cJSON_Keys * const keys, const unsigned char *key, size_t length)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    size_t slot = hash_key(key, length) & (CJSON_KEYS_SLOTS - 1);
+    char *interned = NULL;
 
-    if (prebuffer < 0)
+    while (keys->slots[slot] != NULL)
     {
-        return NULL;
+        if ((strncmp(keys->slots[slot], (const char*)key, length) == 0) && (keys->slots[slot][length] == '\0'))
+        {
+            return keys->slots[slot];
+        }
+        slot = (slot + 1) & (CJSON_KEYS_SLOTS - 1);
     }
 
-    p.buffer = (unsigned char*)global_hooks.allocate((size_t)prebuffer);
-    if (!p.buffer)
+    /* one slot stays empty to end the probing */
+    if (((keys->count + 1) >= CJSON_KEYS_SLOTS) || ((keys->size - keys->used) <= length))
     {
         return NULL;
     }
+    interned = keys->buffer + keys->used;
+    memcpy(interned, key, length);
+    interned[length] = '\0';
+    keys->used += length + 1;
+    keys->count++;
+    keys->slots[slot] = interned;
 
-    p.length = (size_t)prebuffer;
-    p.offset = 0;
-    p.noalloc = false;
-    p.format = fmt;
-    p.hooks = global_hooks;
+    return interned;
+}
 
-    if (!print_value(item, &p))
+CJSON_PUBLIC(void) cJSON_InitKeys(cJSON_Keys * const keys, void *buffer, size_t size)
+{
+    if (keys == NULL)
+    {
+        return;
+    }
+
+    memset(keys, '\0', sizeof(cJSON_Keys));
+    keys->buffer = (char*)buffer;
+    keys->size = (buffer != NULL) ? size : 0;
+}
+
+CJSON_PUBLIC(const char *) cJSON_InternKey(cJSON_Keys * const keys, const char *key)
+{
+    if ((keys == NULL) || (key == NULL))
     {
-        global_hooks.deallocate(p.buffer);
         return NULL;
     }
 
-    return (char*)p.buffer;
+    return intern_key(keys, (const unsigned char*)key, strlen(key));
 }
 
-CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithKeys(cJSON_Keys * const keys, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
 
-    if ((length < 0) || (buffer == NULL))
+    if (keys == NULL)
     {
-        return false;
+        return NULL;
     }
 
-    p.buffer = (unsigned char*)buffer;
-    p.length = (size_t)length;
-    p.offset = 0;
-    p.noalloc = true;
-    p.format = format;
-    p.hooks = global_hooks;
-
-    return print_value(item, &p);
+    buffer.keys = keys;
+    return parse_document(buffer, value, buffer_length, return_parse_end, require_null_terminated);
 }
 
-/* Parser core - when encountering text, process appropriately. */
-static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+CJSON_PUBLIC(void) cJSON_InitContext(cJSON_Context * const context, const cJSON_Hooks * const hooks)
 {
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    if (context == NULL)
     {
-        return false; /* no input */
+        return;
     }
 
-    /* parse the different types of values */
-    /* null */
-    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    memset(context, '\0', sizeof(cJSON_Context));
+    context->hooks.malloc_fn = internal_malloc;
+    context->hooks.free_fn = internal_free;
+    if (hooks != NULL)
     {
-        item->type = cJSON_NULL;
-        input_buffer->offset += 4;
-        return true;
+        if (hooks->malloc_fn != NULL)
+        {
+            context->hooks.malloc_fn = hooks->malloc_fn;
+        }
+        if (hooks->free_fn != NULL)
+        {
+            context->hooks.free_fn = hooks->free_fn;
+        }
     }
-    /* false */
-    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    context->nesting_limit = CJSON_NESTING_LIMIT;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithContext(cJSON_Context * const context, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
+
+    if (context == NULL)
     {
-        item->type = cJSON_False;
-        input_buffer->offset += 5;
-        return true;
+        return NULL;
     }
-    /* true */
-    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+
+    buffer.context = context;
+    return parse_document(buffer, value, buffer_length, return_parse_end, require_null_terminated);
+}
+
+/* Streaming parser */
+enum stream_states
+{
+    stream_value, /* expecting any value */
+    stream_array_first, /* after '[', expecting a value or ']' */
+    stream_object_first, /* after '{', expecting a key or '}' */
+    stream_object_key, /* after ',' in an object, expecting a key */
+    stream_key, /* inside a key */
+    stream_colon, /* after a key, expecting ':' */
+    stream_after_value, /* expecting ',' or the end of the current array/object */
+    stream_string,
+    stream_number,
+    stream_literal,
+    stream_done,
+    stream_error
+};
+
+/* what happens to the bytes of the string that is being read */
+enum stream_string_states
+{
+    stream_string_plain,
+    stream_string_escape,
+    stream_string_unicode
+};
+
+#define stream_path_bit(index) (1UL << (index))
+
+CJSON_PUBLIC(cJSON_bool) cJSON_InitStream(cJSON_Stream * const stream, const char * const *paths, int path_count, cJSON_StreamCallback callback, void *user_data)
+{
+    int i = 0;
+
+    if ((stream == NULL) || (path_count < 0) || (path_count > CJSON_STREAM_MAX_PATHS) || ((paths == NULL) && (path_count > 0)))
     {
-        item->type = cJSON_True;
-        item->valueint = 1;
-        input_buffer->offset += 4;
-        return true;
+        return false;
     }
-    /* string */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+
+    memset(stream, '\0', sizeof(cJSON_Stream));
+    for (i = 0; i < path_count; i++)
     {
-        return parse_string(item, input_buffer);
+        /* positions into the path are stored in an unsigned char */
+        if ((paths[i] == NULL) || (strlen(paths[i]) > UCHAR_MAX))
+        {
+            return false;
+        }
+        stream->paths[i] = paths[i];
+        stream->pending |= stream_path_bit(i);
     }
-    /* number */
-    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+    stream->path_count = path_count;
+    stream->callback = callback;
+    stream->user_data = user_data;
+    stream->state = stream_value;
+
+    return true;
+}
+
+/* call the callback for every path in mask that ends at the given positions */
+static void stream_report(cJSON_Stream * const stream, unsigned long mask, const unsigned char * const position, cJSON * const item)
+{
+    int i = 0;
+
+    if (stream->callback == NULL)
     {
-        return parse_number(item, input_buffer);
+        return;
     }
-    /* array */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '['))
+
+    for (i = 0; i < stream->path_count; i++)
     {
-        return parse_array(item, input_buffer);
+        if ((mask & stream_path_bit(i)) && (stream->paths[i][position[i]] == '\0'))
+        {
+            stream->callback(stream->user_data, i, item);
+        }
     }
-    /* object */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '{'))
+}
+
+/* check if any path in mask ends at the given positions */
+static cJSON_bool stream_complete(const cJSON_Stream * const stream, unsigned long mask, const unsigned char * const position)
+{
+    int i = 0;
+
+    for (i = 0; i < stream->path_count; i++)
     {
-        return parse_object(item, input_buffer);
+        if ((mask & stream_path_bit(i)) && (stream->paths[i][position[i]] == '\0'))
+        {
+            return true;
+        }
     }
 
     return false;
 }
 
-/* Render a value to text. */
-static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+/* work out which paths match the current element of the array on top of the stack */
+static void stream_select_element(cJSON_Stream * const stream)
 {
-    unsigned char *output = NULL;
+    const cJSON_StreamLevel *level = &stream->levels[stream->depth - 1];
+    int i = 0;
 
-    if ((item == NULL) || (output_buffer == NULL))
+    stream->pending = 0;
+    for (i = 0; i < stream->path_count; i++)
     {
-        return false;
-    }
+        const char *segment = stream->paths[i] + level->position[i];
+        const char *end = NULL;
+        size_t index = 0;
 
-    switch ((item->type) & 0xFF)
-    {
-        case cJSON_NULL:
-            output = ensure(output_buffer, 5);
-            if (output == NULL)
+        if (!(level->matching & stream_path_bit(i)) || (segment[0] != '['))
+        {
+            continue;
+        }
+
+        if ((segment[1] == '*') && (segment[2] == ']'))
+        {
+            end = segment + 3;
+        }
+        else
+        {
+            for (end = segment + 1; (*end >= '0') && (*end <= '9'); end++)
             {
-                return false;
+                index = (index * 10) + (size_t)(*end - '0');
             }
-            strcpy((char*)output, "null");
-            return true;
-
-        case cJSON_False:
-            output = ensure(output_buffer, 6);
-            if (output == NULL)
+            if ((end == (segment + 1)) || (*end != ']') || (index != level->index))
             {
-                return false;
+                continue;
             }
-            strcpy((char*)output, "false");
+            end++;
+        }
+
+        if (*end == '.')
+        {
+            end++;
+        }
+        stream->pending |= stream_path_bit(i);
+        stream->pending_position[i] = (unsigned char)(end - stream->paths[i]);
+    }
+}
+
+/* start matching a key against the paths of the object on top of the stack */
+static void stream_start_key(cJSON_Stream * const stream)
+{
+    const cJSON_StreamLevel *level = &stream->levels[stream->depth - 1];
+    int i = 0;
+
+    stream->pending = 0;
+    for (i = 0; i < stream->path_count; i++)
+    {
+        char next = stream->paths[i][level->position[i]];
+        if ((level->matching & stream_path_bit(i)) && (next != '\0') && (next != '['))
+        {
+            stream->pending |= stream_path_bit(i);
+        }
+    }
+    stream->key_length = 0;
+}
+
+/* compare the next byte of a key against the paths that still match */
+static void stream_match_key(cJSON_Stream * const stream, unsigned char byte)
+{
+    const cJSON_StreamLevel *level = &stream->levels[stream->depth - 1];
+    int i = 0;
+
+    for (i = 0; i < stream->path_count; i++)
+    {
+        char expected = '\0';
+
+        if (!(stream->pending & stream_path_bit(i)))
+        {
+            continue;
+        }
+
+        expected = stream->paths[i][level->position[i] + stream->key_length];
+        if ((expected == '\0') || (expected == '.') || (expected == '[') || ((unsigned char)expected != byte))
+        {
+            stream->pending &= ~stream_path_bit(i);
+        }
+    }
+    stream->key_length++;
+}
+
+/* the key is complete, keep the paths whose segment ended together with it */
+static void stream_finish_key(cJSON_Stream * const stream)
+{
+    const cJSON_StreamLevel *level = &stream->levels[stream->depth - 1];
+    int i = 0;
+
+    for (i = 0; i < stream->path_count; i++)
+    {
+        size_t end = level->position[i] + stream->key_length;
+        char next = '\0';
+
+        if (!(stream->pending & stream_path_bit(i)))
+        {
+            continue;
+        }
+
+        next = stream->paths[i][end];
+        if ((next != '\0') && (next != '.') && (next != '['))
+        {
+            stream->pending &= ~stream_path_bit(i);
+            continue;
+        }
+        if (next == '.')
+        {
+            end++;
+        }
+        stream->pending_position[i] = (unsigned char)end;
+    }
+}
+
+/* a byte of string content after unescaping */
+static cJSON_bool stream_string_byte(cJSON_Stream * const stream, unsigned char byte)
+{
+    if (stream->state == stream_key)
+    {
+        stream_match_key(stream, byte);
+        return true;
+    }
+
+    if (!stream->capture)
+    {
+        /* nobody is interested in this string */
+        return true;
+    }
+
+    if (stream->token_length >= (sizeof(stream->token) - 1))
+    {
+        return false; /* requested string is too long */
+    }
+    stream->token[stream->token_length++] = byte;
+
+    return true;
+}
+
+static cJSON_bool stream_push(cJSON_Stream * const stream, unsigned char type)
+{
+    cJSON_StreamLevel *level = NULL;
+
+    if (stream->depth >= CJSON_STREAM_NESTING_LIMIT)
+    {
+        return false; /* too deeply nested */
+    }
+
+    level = &stream->levels[stream->depth];
+    level->matching = stream->pending;
+    level->index = 0;
+    level->type = type;
+    memcpy(level->position, stream->pending_position, sizeof(level->position));
+    stream->depth++;
+
+    return true;
+}
+
+/* a value was completed, continue in the container around it */
+static void stream_value_done(cJSON_Stream * const stream)
+{
+    stream->state = (stream->depth == 0) ? stream_done : stream_after_value;
+}
+
+static cJSON_bool stream_finish_number(cJSON_Stream * const stream)
+{
+    cJSON item;
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL, 0, false, 0, NULL, NULL, 0, NULL };
+
+    memset(&item, '\0', sizeof(item));
+    buffer.content = stream->token;
+    buffer.length = stream->token_length;
+
+    /* the whole token has to be a number */
+    if (!parse_number(&item, &buffer) || (buffer.offset != stream->token_length))
+    {
+        return false;
+    }
+
+    stream_report(stream, stream->pending, stream->pending_position, &item);
+    stream_value_done(stream);
+
+    return true;
+}
+
+/* first byte of a value */
+static cJSON_bool stream_start_value(cJSON_Stream * const stream, unsigned char byte)
+{
+    switch (byte)
+    {
+        case '{':
+            stream->state = stream_object_first;
+            return stream_push(stream, cJSON_Object);
+
+        case '[':
+            stream->state = stream_array_first;
+            return stream_push(stream, cJSON_Array);
+
+        case '\"':
+            stream->state = stream_string;
+            stream->string_state = stream_string_plain;
+            stream->capture = stream_complete(stream, stream->pending, stream->pending_position);
+            stream->token_length = 0;
+            return true;
+
+        case 't':
+            stream->literal = "true";
+            break;
+
+        case 'f':
+            stream->literal = "false";
+            break;
+
+        case 'n':
+            stream->literal = "null";
+            break;
+
+        default:
+            if ((byte == '-') || ((byte >= '0') && (byte <= '9')))
+            {
+                stream->state = stream_number;
+                stream->token[0] = byte;
+                stream->token_length = 1;
+                return true;
+            }
+            return false;
+    }
+
+    stream->state = stream_literal;
+    stream->literal_length = 1;
+
+    return true;
+}
+
+/* closing bracket of the array/object on top of the stack */
+static void stream_pop(cJSON_Stream * const stream)
+{
+    cJSON_StreamLevel *level = &stream->levels[stream->depth - 1];
+    cJSON item;
+
+    memset(&item, '\0', sizeof(item));
+    item.type = level->type;
+    stream->depth--;
+    stream_report(stream, level->matching, level->position, &item);
+    stream_value_done(stream);
+}
+
+static cJSON_bool stream_end_string(cJSON_Stream * const stream)
+{
+    cJSON item;
+
+    if (stream->state == stream_key)
+    {
+        stream_finish_key(stream);
+        stream->state = stream_colon;
+        return true;
+    }
+
+    memset(&item, '\0', sizeof(item));
+    stream->token[stream->token_length] = '\0';
+    item.type = cJSON_String;
+    cJSON_ValueString(&item) = (char*)stream->token;
+    stream_report(stream, stream->pending, stream->pending_position, &item);
+    stream_value_done(stream);
+
+    return true;
+}
+
+/* content of a key or string value */
+static cJSON_bool stream_string_step(cJSON_Stream * const stream, unsigned char byte)
+{
+    unsigned char utf8[4];
+    unsigned char *utf8_pointer = utf8;
+    unsigned char *utf8_byte = NULL;
+    unsigned int first_code = 0;
+
+    switch (stream->string_state)
+    {
+        case stream_string_plain:
+            if (byte == '\"')
+            {
+                return stream_end_string(stream);
+            }
+            if (byte == '\\')
+            {
+                stream->string_state = stream_string_escape;
+                return true;
+            }
+            return stream_string_byte(stream, byte);
+
+        case stream_string_escape:
+            stream->string_state = stream_string_plain;
+            switch (byte)
+            {
+                case 'b':
+                    return stream_string_byte(stream, '\b');
+                case 'f':
+                    return stream_string_byte(stream, '\f');
+                case 'n':
+                    return stream_string_byte(stream, '\n');
+                case 'r':
+                    return stream_string_byte(stream, '\r');
+                case 't':
+                    return stream_string_byte(stream, '\t');
+                case '\"':
+                case '\\':
+                case '/':
+                    return stream_string_byte(stream, byte);
+                case 'u':
+                    stream->escape[0] = '\\';
+                    stream->escape[1] = 'u';
+                    stream->escape_length = 2;
+                    stream->string_state = stream_string_unicode;
+                    return true;
+                default:
+                    return false;
+            }
+
+        case stream_string_unicode:
+            stream->escape[stream->escape_length++] = byte;
+            if (stream->escape_length == 6)
+            {
+                /* the first half of a surrogate pair needs a second \uXXXX */
+                first_code = parse_hex4(stream->escape + 2);
+                if ((first_code >= 0xD800) && (first_code <= 0xDBFF))
+                {
+                    return true;
+                }
+            }
+            else if (stream->escape_length != sizeof(stream->escape))
+            {
+                return true;
+            }
+
+            stream->string_state = stream_string_plain;
+            if (utf16_literal_to_utf8(stream->escape, stream->escape + stream->escape_length, &utf8_pointer) == 0)
+            {
+                return false;
+            }
+            for (utf8_byte = utf8; utf8_byte < utf8_pointer; utf8_byte++)
+            {
+                if (!stream_string_byte(stream, *utf8_byte))
+                {
+                    return false;
+                }
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static cJSON_bool stream_step(cJSON_Stream * const stream, unsigned char byte)
+{
+    cJSON item;
+
+    switch (stream->state)
+    {
+        case stream_string:
+        case stream_key:
+            return stream_string_step(stream, byte);
+
+        case stream_number:
+            if (((byte >= '0') && (byte <= '9')) || (byte == '+') || (byte == '-') || (byte == '.') || (byte == 'e') || (byte == 'E'))
+            {
+                if (stream->token_length >= (sizeof(stream->token) - 1))
+                {
+                    return false; /* parse_number can't handle more either */
+                }
+                stream->token[stream->token_length++] = byte;
+                return true;
+            }
+            /* the number ends in front of this byte */
+            if (!stream_finish_number(stream))
+            {
+                return false;
+            }
+            return stream_step(stream, byte);
+
+        case stream_literal:
+            if (byte != (unsigned char)stream->literal[stream->literal_length])
+            {
+                return false;
+            }
+            stream->literal_length++;
+            if (stream->literal[stream->literal_length] != '\0')
+            {
+                return true;
+            }
+            memset(&item, '\0', sizeof(item));
+            switch (stream->literal[0])
+            {
+                case 't':
+                    item.type = cJSON_True;
+                    set_valueint(&item, 1);
+                    break;
+                case 'f':
+                    item.type = cJSON_False;
+                    break;
+                default:
+                    item.type = cJSON_NULL;
+                    break;
+            }
+            stream_report(stream, stream->pending, stream->pending_position, &item);
+            stream_value_done(stream);
+            return true;
+
+        default:
+            break;
+    }
+
+    /* whitespace between tokens */
+    if (byte <= 32)
+    {
+        return true;
+    }
+
+    switch (stream->state)
+    {
+        case stream_value:
+            return stream_start_value(stream, byte);
+
+        case stream_array_first:
+            if (byte == ']')
+            {
+                stream_pop(stream);
+                return true;
+            }
+            stream_select_element(stream);
+            return stream_start_value(stream, byte);
+
+        case stream_object_first:
+            if (byte == '}')
+            {
+                stream_pop(stream);
+                return true;
+            }
+            /* fall through */
+        case stream_object_key:
+            if (byte != '\"')
+            {
+                return false;
+            }
+            stream_start_key(stream);
+            stream->state = stream_key;
+            stream->string_state = stream_string_plain;
+            return true;
+
+        case stream_colon:
+            if (byte != ':')
+            {
+                return false;
+            }
+            stream->state = stream_value;
+            return true;
+
+        case stream_after_value:
+            if (byte == ',')
+            {
+                if (stream->levels[stream->depth - 1].type == cJSON_Object)
+                {
+                    stream->state = stream_object_key;
+                    return true;
+                }
+                stream->levels[stream->depth - 1].index++;
+                stream_select_element(stream);
+                stream->state = stream_value;
+                return true;
+            }
+            if (((byte == '}') && (stream->levels[stream->depth - 1].type == cJSON_Object))
+                || ((byte == ']') && (stream->levels[stream->depth - 1].type == cJSON_Array)))
+            {
+                stream_pop(stream);
+                return true;
+            }
+            return false;
+
+        default:
+            /* nothing but whitespace is allowed after the value */
+            return false;
+    }
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_FeedStream(cJSON_Stream * const stream, const char *chunk, size_t length)
+{
+    size_t i = 0;
+
+    if ((stream == NULL) || ((chunk == NULL) && (length > 0)) || (stream->state == stream_error))
+    {
+        return false;
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        if (!stream_step(stream, (unsigned char)chunk[i]))
+        {
+            stream->state = stream_error;
+            return false;
+        }
+        stream->offset++;
+    }
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_FinishStream(cJSON_Stream * const stream)
+{
+    if (stream == NULL)
+    {
+        return false;
+    }
+
+    /* a number at the top level only ends with the input */
+    if ((stream->state == stream_number) && (stream->depth == 0))
+    {
+        if (!stream_finish_number(stream))
+        {
+            stream->state = stream_error;
+        }
+    }
+
+    return stream->state == stream_done;
+}
+
+
+static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+{
+    static const size_t default_buffer_size = 256;
+    printbuffer buffer[1];
+    unsigned char *printed = NULL;
+
+    memset(buffer, 0, sizeof(buffer));
+
+    /* create buffer */
+    buffer->buffer = (unsigned char*) hooks->allocate(default_buffer_size);
+    buffer->length = default_buffer_size;
+    buffer->format = format;
+    buffer->hooks = *hooks;
+    if (buffer->buffer == NULL)
+    {
+        goto fail;
+    }
+
+    /* print the value */
+    if (!print_value(item, buffer))
+    {
+        goto fail;
+    }
+    update_offset(buffer);
+
+    /* check if reallocate is available */
+    if (hooks->reallocate != NULL)
+    {
+        printed = (unsigned char*) hooks->reallocate(buffer->buffer, buffer->offset + 1);
+        if (printed == NULL) {
+            goto fail;
+        }
+        buffer->buffer = NULL;
+    }
+    else /* otherwise copy the JSON over to a new buffer */
+    {
+        printed = (unsigned char*) hooks->allocate(buffer->offset + 1);
+        if (printed == NULL)
+        {
+            goto fail;
+        }
+        memcpy(printed, buffer->buffer, cjson_min(buffer->length, buffer->offset + 1));
+        printed[buffer->offset] = '\0'; /* just to be sure */
+
+        /* free the buffer */
+        hooks->deallocate(buffer->buffer);
+    }
+
+    return printed;
+
+fail:
+    if (buffer->buffer != NULL)
+    {
+        hooks->deallocate(buffer->buffer);
+    }
+
+    if (printed != NULL)
+    {
+        hooks->deallocate(printed);
+    }
+
+    return NULL;
+}
+
+/* Render a cJSON item/entity/structure to text. */
+CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item)
+{
+    return (char*)print(item, true, &global_hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
+{
+    return (char*)print(item, false, &global_hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
+
+    if (prebuffer < 0)
+    {
+        return NULL;
+    }
+
+    p.buffer = (unsigned char*)global_hooks.allocate((size_t)prebuffer);
+    if (!p.buffer)
+    {
+        return NULL;
+    }
+
+    p.length = (size_t)prebuffer;
+    p.offset = 0;
+    p.noalloc = false;
+    p.format = fmt;
+    p.hooks = global_hooks;
+
+    if (!print_value(item, &p))
+    {
+        global_hooks.deallocate(p.buffer);
+        return NULL;
+    }
+
+    return (char*)p.buffer;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
+
+    if ((length < 0) || (buffer == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)buffer;
+    p.length = (size_t)length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+
+    return print_value(item, &p);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintToSink(const cJSON *item, cJSON_bool format, char *window, size_t window_size, cJSON_PrintSink sink, void *user_data)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
+
+    if ((window == NULL) || (window_size == 0) || (sink == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)window;
+    p.length = window_size;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+    p.sink = sink;
+    p.sink_data = user_data;
+
+    if (!print_value(item, &p))
+    {
+        return false;
+    }
+    update_offset(&p);
+
+    return flush_sink(&p);
+}
+
+/* Parser core - when encountering text, process appropriately. Arrays and objects are handled by parse_value. */
+static cJSON_bool parse_scalar(cJSON * const item, parse_buffer * const input_buffer)
+{
+    /* parse the different types of values */
+    /* null */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    {
+        item->type = cJSON_NULL;
+        input_buffer->offset += 4;
+        return true;
+    }
+    /* false */
+    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        item->type = cJSON_False;
+        input_buffer->offset += 5;
+        return true;
+    }
+    /* true */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+    {
+        item->type = cJSON_True;
+        set_valueint(item, 1);
+        input_buffer->offset += 4;
+        return true;
+    }
+    /* string */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    {
+        return parse_string(item, input_buffer);
+    }
+    /* number */
+    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+    {
+        return parse_number(item, input_buffer);
+    }
+
+    return false;
+}
+
+/* Render a value to text. Arrays and objects are handled by print_value. */
+static cJSON_bool print_scalar(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output = NULL;
+
+    switch ((item->type) & 0xFF)
+    {
+        case cJSON_NULL:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "null");
+            return true;
+
+        case cJSON_False:
+            output = ensure(output_buffer, 6);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "false");
             return true;
 
         case cJSON_True:
@@ -1401,321 +2998,689 @@ static cJSON_bool print_value(const cJSON * const item, printbuffer * const outp
         case cJSON_Raw:
         {
             size_t raw_length = 0;
-            if (item->valuestring == NULL)
+            if (cJSON_ValueString(item) == NULL)
             {
                 return false;
             }
 
-            raw_length = strlen(item->valuestring) + sizeof("");
+            raw_length = strlen(cJSON_ValueString(item)) + sizeof("");
             output = ensure(output_buffer, raw_length);
             if (output == NULL)
             {
                 return false;
             }
-            memcpy(output, item->valuestring, raw_length);
+            memcpy(output, cJSON_ValueString(item), raw_length);
             return true;
         }
 
         case cJSON_String:
             return print_string(item, output_buffer);
 
-        case cJSON_Array:
-            return print_array(item, output_buffer);
-
-        case cJSON_Object:
-            return print_object(item, output_buffer);
-
         default:
             return false;
     }
 }
-
-/* Build an array from input text. */
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+/* skip over a string without decoding it, only checking that it is terminated */
+static cJSON_bool skip_string(parse_buffer * const input_buffer)
 {
-    cJSON *head = NULL; /* head of the linked list */
-    cJSON *current_item = NULL;
-
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"'))
     {
-        return false; /* to deeply nested */
+        return false;
     }
-    input_buffer->depth++;
 
-    if (buffer_at_offset(input_buffer)[0] != '[')
+    for (input_buffer->offset++; can_access_at_index(input_buffer, 0); input_buffer->offset++)
     {
-        /* not an array */
-        goto fail;
+        input_buffer->offset = (size_t)(scan_string(buffer_at_offset(input_buffer), input_buffer->content + input_buffer->length) - input_buffer->content);
+        if (cannot_access_at_index(input_buffer, 0))
+        {
+            break;
+        }
+        if (buffer_at_offset(input_buffer)[0] == '\\')
+        {
+            input_buffer->offset++;
+        }
+        else
+        {
+            input_buffer->offset++;
+            return true;
+        }
     }
 
-    input_buffer->offset++;
+    return false;
+}
+
+/* skip over the name of an object member and the colon after it */
+static cJSON_bool skip_name(parse_buffer * const input_buffer)
+{
+    buffer_skip_whitespace(input_buffer);
+    if (!skip_string(input_buffer))
+    {
+        return false; /* failed to skip name */
+    }
     buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
     {
-        /* empty array */
-        goto success;
+        return false; /* invalid object */
     }
+    input_buffer->offset++;
+
+    return true;
+}
+
+/* levels of a skipped value that fit in skip_stack without allocating */
+#define SKIP_STACK_INLINE 256
+
+/* one bit per array or object that skip_value is inside of, set for objects */
+typedef struct
+{
+    unsigned char *bits;
+    size_t depth;
+    size_t size; /* in levels */
+    unsigned char inline_bits[SKIP_STACK_INLINE / 8];
+} skip_stack;
 
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
+static cJSON_bool skip_stack_push(skip_stack * const stack, const cJSON_bool object, const internal_hooks * const hooks)
+{
+    if (stack->depth == stack->size)
     {
-        input_buffer->offset--;
-        goto fail;
+        unsigned char *bits = (unsigned char*)hooks->allocate(2 * stack->size / 8);
+        if (bits == NULL)
+        {
+            return false;
+        }
+        memcpy(bits, stack->bits, stack->size / 8);
+        if (stack->bits != stack->inline_bits)
+        {
+            hooks->deallocate(stack->bits);
+        }
+        stack->bits = bits;
+        stack->size *= 2;
+    }
+    if (object)
+    {
+        stack->bits[stack->depth / 8] |= (unsigned char)(1 << (stack->depth % 8));
+    }
+    else
+    {
+        stack->bits[stack->depth / 8] &= (unsigned char)~(1 << (stack->depth % 8));
     }
+    stack->depth++;
+
+    return true;
+}
+
+/* the bracket that closes the innermost open array or object */
+#define skip_stack_closer(stack) ((((stack)->bits[((stack)->depth - 1) / 8] >> (((stack)->depth - 1) % 8)) & 1) ? '}' : ']')
+
+/* skip over a value that nothing selects without building it. Strings only have to be terminated, numbers and
+ * literals are checked like parse_value would, and arrays and objects need the same commas, colons, names and
+ * matching brackets as when they are parsed. */
+static cJSON_bool skip_value(parse_buffer * const input_buffer)
+{
+    skip_stack open;
+    cJSON_bool value_done = false;
+    cJSON_bool skipped = false;
+    unsigned char current = '\0';
+    cJSON scalar;
+
+    open.bits = open.inline_bits;
+    open.depth = 0;
+    open.size = SKIP_STACK_INLINE;
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
+    while (true)
     {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
+        if (value_done && (open.depth == 0))
         {
-            goto fail; /* allocation failure */
+            skipped = true;
+            break;
+        }
+
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0))
+        {
+            break;
+        }
+        current = buffer_at_offset(input_buffer)[0];
+
+        if (value_done)
+        {
+            /* after a value the array or object around it either goes on or ends */
+            if (current == ',')
+            {
+                input_buffer->offset++;
+                value_done = false;
+                if ((skip_stack_closer(&open) == '}') && !skip_name(input_buffer))
+                {
+                    break;
+                }
+                continue;
+            }
+            if (current != skip_stack_closer(&open))
+            {
+                break; /* mismatched or missing bracket */
+            }
+            input_buffer->offset++;
+            open.depth--;
+            continue;
+        }
+
+        if ((current == '[') || (current == '{'))
+        {
+            if ((input_buffer->depth + open.depth + 1) > input_buffer->nesting_limit)
+            {
+                break; /* to deeply nested */
+            }
+            if (!skip_stack_push(&open, current == '{', &input_buffer->hooks))
+            {
+                break;
+            }
+            input_buffer->offset++;
+            buffer_skip_whitespace(input_buffer);
+            if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == skip_stack_closer(&open)))
+            {
+                /* empty, closed like after a value */
+                value_done = true;
+                continue;
+            }
+            if ((current == '{') && !skip_name(input_buffer))
+            {
+                break;
+            }
+            continue;
         }
 
-        /* attach next item to list */
-        if (head == NULL)
+        if (current == '\"')
         {
-            /* start the linked list */
-            current_item = head = new_item;
+            if (!skip_string(input_buffer))
+            {
+                break;
+            }
         }
         else
         {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
+            memset(&scalar, '\0', sizeof(scalar));
+            if (!parse_scalar(&scalar, input_buffer))
+            {
+                break;
+            }
         }
+        value_done = true;
+    }
 
-        /* parse next value */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+    if (open.bits != open.inline_bits)
+    {
+        input_buffer->hooks.deallocate(open.bits);
+    }
+
+    return skipped;
+}
+
+/* find the step below the current one that selects the key of length bytes, returns 0 if there is none */
+static unsigned char select_key(const parse_buffer * const input_buffer, const unsigned char *key, size_t length)
+{
+    const cJSON_Selector *selector = input_buffer->selector;
+    unsigned char current = selector->steps[input_buffer->step].child;
+
+    for (; current != 0; current = selector->steps[current].next)
+    {
+        const cJSON_SelectorStep *step = &selector->steps[current];
+        if ((step->key >= 0) && (strncmp(selector->keys + step->key, (const char*)key, length) == 0) && (selector->keys[step->key + (int)length] == '\0'))
         {
-            goto fail; /* failed to parse value */
+            return current;
         }
-        buffer_skip_whitespace(input_buffer);
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
 
-    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
+    return 0;
+}
+
+/* find the step that selects the name at the offset, without allocating unless the name has escapes in it */
+static unsigned char select_name(parse_buffer * const input_buffer)
+{
+    const unsigned char *name = buffer_at_offset(input_buffer) + 1;
+    size_t length = 0;
+    size_t offset = input_buffer->offset;
+    cJSON_bool insitu = input_buffer->insitu;
+    unsigned char step = 0;
+    cJSON decoded;
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"'))
+    {
+        return 0;
+    }
+
+    while (can_access_at_index(input_buffer, length + 1) && (name[length] != '\"') && (name[length] != '\\'))
+    {
+        length++;
+    }
+    if (cannot_access_at_index(input_buffer, length + 1))
+    {
+        return 0;
+    }
+    if (name[length] == '\"')
+    {
+        return select_key(input_buffer, name, length);
+    }
+
+    /* the name is parsed again if it is selected, so it has to stay as it is */
+    input_buffer->insitu = false;
+    memset(&decoded, '\0', sizeof(decoded));
+    if (parse_string(&decoded, input_buffer))
     {
-        goto fail; /* expected end of array */
+        step = select_key(input_buffer, (const unsigned char*)cJSON_ValueString(&decoded), strlen(cJSON_ValueString(&decoded)));
+        parse_deallocate(input_buffer, cJSON_ValueString(&decoded));
     }
+    input_buffer->insitu = insitu;
+    input_buffer->offset = offset;
 
-success:
-    input_buffer->depth--;
+    return step;
+}
+
+/* find the step below the current one that selects the element at index, returns 0 if there is none */
+static unsigned char select_element(const parse_buffer * const input_buffer, size_t index)
+{
+    const cJSON_Selector *selector = input_buffer->selector;
+    unsigned char current = selector->steps[input_buffer->step].child;
+
+    for (; current != 0; current = selector->steps[current].next)
+    {
+        const cJSON_SelectorStep *step = &selector->steps[current];
+        if ((step->key < 0) && (step->any || (step->index == index)))
+        {
+            return current;
+        }
+    }
+
+    return 0;
+}
+
+/* allocate an item and add it to the end of the children of parent, whose first child links to the last one */
+static cJSON *parse_append_item(parse_buffer * const input_buffer, cJSON * const parent)
+{
+    cJSON *new_item = parse_new_item(input_buffer);
+    if (new_item == NULL)
+    {
+        return NULL; /* allocation failure */
+    }
+
+    if (cJSON_Child(parent) == NULL)
+    {
+        /* start the linked list */
+        cJSON_Child(parent) = new_item;
+    }
+    else
+    {
+        /* add to the end */
+        new_item->prev = cJSON_Child(parent)->prev;
+        cJSON_Child(parent)->prev->next = new_item;
+    }
+    cJSON_Child(parent)->prev = new_item;
+
+    return new_item;
+}
+
+/* start to fill item with the array or object at the offset, step is what the selector selects it with */
+static cJSON_bool parse_open(cJSON * const item, parse_buffer * const input_buffer, unsigned char step)
+{
+    const cJSON_Selector *selector = input_buffer->selector;
+
+    if (input_buffer->depth >= input_buffer->nesting_limit)
+    {
+        return false; /* to deeply nested */
+    }
+
+    if (selector != NULL)
+    {
+        parse_level *level = NULL;
 
-    if (head != NULL) {
-        head->prev = current_item;
+        if (input_buffer->level_count >= CJSON_SELECTOR_MAX_STEPS)
+        {
+            return false;
+        }
+        level = &input_buffer->levels[input_buffer->level_count++];
+        level->depth = input_buffer->depth + 1;
+        level->index = 0;
+        level->skipped = 0;
+        level->selector = selector;
+        level->step = input_buffer->step;
+
+        /* a path ending at step keeps all of it */
+        if (selector->steps[step].ends != 0)
+        {
+            input_buffer->selector = NULL;
+        }
+        input_buffer->step = step;
     }
+    input_buffer->depth++;
 
-    item->type = cJSON_Array;
-    item->child = head;
+    /* a name in the input stays flagged */
+    item->type = ((buffer_at_offset(input_buffer)[0] == '[') ? cJSON_Array : cJSON_Object) | (item->type & cJSON_StringIsConst);
+    cJSON_Child(item) = NULL;
 
     input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
 
     return true;
+}
 
-fail:
-    if (head != NULL)
+/* finish item at its closing bracket, returns the array or object around it */
+static cJSON *parse_close(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *parent = item->next;
+
+    item->next = NULL;
+    if ((input_buffer->level_count > 0) && (input_buffer->levels[input_buffer->level_count - 1].depth == input_buffer->depth))
     {
-        cJSON_Delete(head);
+        parse_level *level = &input_buffer->levels[--input_buffer->level_count];
+        input_buffer->selector = level->selector;
+        input_buffer->step = level->step;
     }
+    input_buffer->depth--;
+    input_buffer->offset++;
 
-    return false;
+    return parent;
 }
 
-/* Render an array to text */
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
+/* parse the name of a member of an object into item->string, from the interned keys if there are some */
+static cJSON_bool parse_name(cJSON * const item, parse_buffer * const input_buffer)
 {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    cJSON *current_element = item->child;
+    const char *interned = NULL;
 
-    if (output_buffer == NULL)
+    if ((input_buffer->keys != NULL) && can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    {
+        /* a name without escapes is looked up right in the input */
+        const unsigned char *name = buffer_at_offset(input_buffer) + 1;
+        const unsigned char *name_end = scan_string(name, input_buffer->content + input_buffer->length);
+
+        if ((name_end < (input_buffer->content + input_buffer->length)) && (*name_end == '\"'))
+        {
+            interned = intern_key(input_buffer->keys, name, (size_t)(name_end - name));
+            if (interned != NULL)
+            {
+                item->string = (char*)cast_away_const(interned);
+                item->type = cJSON_StringIsConst;
+                input_buffer->offset = (size_t)(name_end - input_buffer->content) + 1;
+
+                return true;
+            }
+        }
+    }
+
+    if (!parse_string(item, input_buffer))
     {
         return false;
     }
 
-    /* Compose the output array. */
-    /* opening square bracket */
-    output_pointer = ensure(output_buffer, 1);
-    if (output_pointer == NULL)
-    {
-        return false;
-    }
+    /* swap valuestring and string, because we parsed the name */
+    item->string = cJSON_ValueString(item);
+    cJSON_ValueString(item) = NULL;
+    if (input_buffer->insitu)
+    {
+        /* the name points into the input and must not be freed */
+        item->type = cJSON_StringIsConst;
+    }
+    else if (input_buffer->keys != NULL)
+    {
+        interned = intern_key(input_buffer->keys, (const unsigned char*)item->string, strlen(item->string));
+        if (interned != NULL)
+        {
+            parse_deallocate(input_buffer, item->string);
+            item->string = (char*)cast_away_const(interned);
+            item->type = cJSON_StringIsConst;
+        }
+    }
+
+    return true;
+}
+
+/* Add the next element of parent as *element, including the name if parent is an object, and set *step to what
+ * the selector selects it with. *element is NULL if the selector left the element out and it was skipped. */
+static cJSON_bool parse_element(cJSON * const parent, parse_buffer * const input_buffer, cJSON ** const element, unsigned char * const step)
+{
+    parse_level *level = (input_buffer->selector != NULL) ? &input_buffer->levels[input_buffer->level_count - 1] : NULL;
+    cJSON *new_item = NULL;
+
+    *element = NULL;
+    *step = 0;
+    buffer_skip_whitespace(input_buffer);
+
+    if (cJSON_IsArray(parent))
+    {
+        if (level != NULL)
+        {
+            *step = select_element(input_buffer, level->index++);
+            if (*step == 0)
+            {
+                /* leave the element out, but keep the index of the ones after it */
+                level->skipped++;
+                return skip_value(input_buffer);
+            }
+
+            for (; level->skipped > 0; level->skipped--)
+            {
+                new_item = parse_append_item(input_buffer, parent);
+                if (new_item == NULL)
+                {
+                    return false; /* allocation failure */
+                }
+                new_item->type = cJSON_NULL;
+            }
+        }
+
+        *element = parse_append_item(input_buffer, parent);
 
-    *output_pointer = '[';
-    output_buffer->offset++;
-    output_buffer->depth++;
+        return *element != NULL;
+    }
 
-    while (current_element != NULL)
+    if (level != NULL)
     {
-        if (!print_value(current_element, output_buffer))
+        *step = select_name(input_buffer);
+        if (*step == 0)
         {
-            return false;
-        }
-        update_offset(output_buffer);
-        if (current_element->next)
-        {
-            length = (size_t) (output_buffer->format ? 2 : 1);
-            output_pointer = ensure(output_buffer, length + 1);
-            if (output_pointer == NULL)
+            /* leave out the name and its value */
+            if (!skip_name(input_buffer))
             {
                 return false;
             }
-            *output_pointer++ = ',';
-            if(output_buffer->format)
-            {
-                *output_pointer++ = ' ';
-            }
-            *output_pointer = '\0';
-            output_buffer->offset += length;
+            buffer_skip_whitespace(input_buffer);
+
+            return skip_value(input_buffer);
         }
-        current_element = current_element->next;
     }
 
-    output_pointer = ensure(output_buffer, 2);
-    if (output_pointer == NULL)
+    new_item = parse_append_item(input_buffer, parent);
+    if (new_item == NULL)
     {
-        return false;
+        return false; /* allocation failure */
     }
-    *output_pointer++ = ']';
-    *output_pointer = '\0';
-    output_buffer->depth--;
-
-    return true;
-}
-
-/* Build an object from the text. */
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer)
-{
-    cJSON *head = NULL; /* linked list head */
-    cJSON *current_item = NULL;
 
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    /* parse the name of the child */
+    if (!parse_name(new_item, input_buffer))
     {
-        return false; /* to deeply nested */
+        return false; /* failed to parse name */
     }
-    input_buffer->depth++;
+    buffer_skip_whitespace(input_buffer);
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '{'))
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
     {
-        goto fail; /* not an object */
+        return false; /* invalid object */
     }
-
     input_buffer->offset++;
     buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
-    {
-        goto success; /* empty object */
-    }
+    *element = new_item;
+
+    return true;
+}
+
+/* Build a value from the text without recursing. An array or object that is still being filled links to the one
+ * around it through next, which only becomes a sibling after the closing bracket, so the stack does not grow with
+ * the nesting. Only the state of a selector needs the levels it is active on. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *parent = NULL; /* the array or object that is being filled */
+    cJSON *current = item; /* what the next value is parsed into, NULL if it was skipped */
+    unsigned char step = 0;
 
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
     {
-        input_buffer->offset--;
-        goto fail;
+        return false; /* no input */
     }
+    step = input_buffer->step;
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
+    for (;;)
     {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
+        if (current == NULL)
         {
-            goto fail; /* allocation failure */
+            /* the selector left the element out */
         }
-
-        /* attach next item to list */
-        if (head == NULL)
+        else if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '[') || (buffer_at_offset(input_buffer)[0] == '{')))
         {
-            /* start the linked list */
-            current_item = head = new_item;
+            if (!parse_open(current, input_buffer, step))
+            {
+                goto fail;
+            }
+            current->next = parent;
+            parent = current;
+
+            if (cannot_access_at_index(input_buffer, 0))
+            {
+                goto fail;
+            }
+            if (buffer_at_offset(input_buffer)[0] != (cJSON_IsArray(parent) ? ']' : '}'))
+            {
+                if (!parse_element(parent, input_buffer, &current, &step))
+                {
+                    goto fail;
+                }
+                continue;
+            }
+            /* empty, it is closed below */
         }
         else
         {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
+            const int name_flags = current->type & cJSON_StringIsConst;
+
+            if (!parse_scalar(current, input_buffer))
+            {
+                goto fail;
+            }
+            current->type |= name_flags; /* parsing the value replaced the type */
         }
 
-        /* parse the name of the child */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_string(current_item, input_buffer))
+        /* close the arrays and objects that end after the value */
+        for (;;)
         {
-            goto fail; /* failed to parse name */
-        }
-        buffer_skip_whitespace(input_buffer);
+            if (parent == NULL)
+            {
+                return true;
+            }
 
-        /* swap valuestring and string, because we parsed the name */
-        current_item->string = current_item->valuestring;
-        current_item->valuestring = NULL;
+            buffer_skip_whitespace(input_buffer);
+            if (cannot_access_at_index(input_buffer, 0))
+            {
+                goto fail;
+            }
+            if (buffer_at_offset(input_buffer)[0] != (cJSON_IsArray(parent) ? ']' : '}'))
+            {
+                break;
+            }
+            parent = parse_close(parent, input_buffer);
+        }
 
-        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        if (buffer_at_offset(input_buffer)[0] != ',')
         {
-            goto fail; /* invalid object */
+            goto fail; /* expected end of array/object */
         }
-
-        /* parse the value */
         input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+        if (!parse_element(parent, input_buffer, &current, &step))
         {
-            goto fail; /* failed to parse value */
+            goto fail;
         }
-        buffer_skip_whitespace(input_buffer);
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+fail:
+    /* the items that were added stay in item for the caller to delete, without the links to the outer levels */
+    while (parent != NULL)
     {
-        goto fail; /* expected end of object */
+        cJSON *outer = parent->next;
+        parent->next = NULL;
+        parent = outer;
     }
 
-success:
-    input_buffer->depth--;
+    return false;
+}
 
-    if (head != NULL) {
-        head->prev = current_item;
-    }
+/* ancestors of the item an iterative walk is at, the first ones are kept without allocating */
+#define ITEM_STACK_INLINE 16
 
-    item->type = cJSON_Object;
-    item->child = head;
+typedef struct
+{
+    const cJSON **items;
+    size_t count;
+    size_t size;
+    const cJSON *inline_items[ITEM_STACK_INLINE];
+} item_stack;
 
-    input_buffer->offset++;
-    return true;
+static void item_stack_init(item_stack * const stack)
+{
+    stack->items = stack->inline_items;
+    stack->count = 0;
+    stack->size = ITEM_STACK_INLINE;
+}
 
-fail:
-    if (head != NULL)
+static cJSON_bool item_stack_push(item_stack * const stack, const cJSON * const item, const internal_hooks * const hooks)
+{
+    if (stack->count == stack->size)
     {
-        cJSON_Delete(head);
+        const cJSON **items = (const cJSON**)hooks->allocate(2 * stack->size * sizeof(cJSON*));
+        if (items == NULL)
+        {
+            return false;
+        }
+        memcpy((void*)items, (const void*)stack->items, stack->count * sizeof(cJSON*));
+        if (stack->items != stack->inline_items)
+        {
+            hooks->deallocate((void*)stack->items);
+        }
+        stack->items = items;
+        stack->size *= 2;
     }
+    stack->items[stack->count++] = item;
 
-    return false;
+    return true;
+}
+
+static void item_stack_free(item_stack * const stack, const internal_hooks * const hooks)
+{
+    if (stack->items != stack->inline_items)
+    {
+        hooks->deallocate((void*)stack->items);
+    }
+    item_stack_init(stack);
 }
 
-/* Render an object to text. */
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer)
+#define item_stack_top(stack) ((stack)->items[(stack)->count - 1])
+
+/* open the array or object item */
+static cJSON_bool print_open(const cJSON * const item, printbuffer * const output_buffer)
 {
     unsigned char *output_pointer = NULL;
     size_t length = 0;
-    cJSON *current_item = item->child;
 
-    if (output_buffer == NULL)
+    if (cJSON_IsArray(item))
     {
-        return false;
+        output_pointer = ensure(output_buffer, 1);
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+
+        *output_pointer = '[';
+        output_buffer->offset++;
+        output_buffer->depth++;
+
+        return true;
     }
 
-    /* Compose the output: */
     length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
     output_pointer = ensure(output_buffer, length + 1);
     if (output_pointer == NULL)
@@ -1731,70 +3696,122 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
     }
     output_buffer->offset += length;
 
-    while (current_item)
-    {
-        if (output_buffer->format)
-        {
-            size_t i;
-            output_pointer = ensure(output_buffer, output_buffer->depth);
-            if (output_pointer == NULL)
-            {
-                return false;
-            }
-            for (i = 0; i < output_buffer->depth; i++)
-            {
-                *output_pointer++ = '\t';
-            }
-            output_buffer->offset += output_buffer->depth;
-        }
+    return true;
+}
 
-        /* print key */
-        if (!print_string_ptr((unsigned char*)current_item->string, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
+/* print the indentation and the key of a member of an object */
+static cJSON_bool print_name(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
 
-        length = (size_t) (output_buffer->format ? 2 : 1);
-        output_pointer = ensure(output_buffer, length);
+    if (output_buffer->format)
+    {
+        size_t i;
+        output_pointer = ensure(output_buffer, output_buffer->depth);
         if (output_pointer == NULL)
         {
             return false;
         }
-        *output_pointer++ = ':';
-        if (output_buffer->format)
+        for (i = 0; i < output_buffer->depth; i++)
         {
             *output_pointer++ = '\t';
         }
-        output_buffer->offset += length;
+        output_buffer->offset += output_buffer->depth;
+    }
+
+    /* print key */
+    if (!print_string_ptr((unsigned char*)item->string, output_buffer))
+    {
+        return false;
+    }
+    update_offset(output_buffer);
+
+    length = (size_t) (output_buffer->format ? 2 : 1);
+    output_pointer = ensure(output_buffer, length);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    *output_pointer++ = ':';
+    if (output_buffer->format)
+    {
+        *output_pointer++ = '\t';
+    }
+    output_buffer->offset += length;
+
+    return true;
+}
+
+/* print what follows item in the array or object parent */
+static cJSON_bool print_separator(const cJSON * const parent, const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
 
-        /* print value */
-        if (!print_value(current_item, output_buffer))
+    if (cJSON_IsArray(parent))
+    {
+        if (item->next == NULL)
         {
-            return false;
+            return true;
         }
-        update_offset(output_buffer);
 
-        /* print comma if not last */
-        length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current_item->next ? 1 : 0));
+        length = (size_t) (output_buffer->format ? 2 : 1);
         output_pointer = ensure(output_buffer, length + 1);
         if (output_pointer == NULL)
         {
             return false;
         }
-        if (current_item->next)
+        *output_pointer++ = ',';
+        if(output_buffer->format)
         {
-            *output_pointer++ = ',';
+            *output_pointer++ = ' ';
         }
+        *output_pointer = '\0';
+        output_buffer->offset += length;
 
-        if (output_buffer->format)
+        return true;
+    }
+
+    /* print comma if not last */
+    length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(item->next ? 1 : 0));
+    output_pointer = ensure(output_buffer, length + 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    if (item->next)
+    {
+        *output_pointer++ = ',';
+    }
+
+    if (output_buffer->format)
+    {
+        *output_pointer++ = '\n';
+    }
+    *output_pointer = '\0';
+    output_buffer->offset += length;
+
+    return true;
+}
+
+/* close the array or object item */
+static cJSON_bool print_close(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+
+    if (cJSON_IsArray(item))
+    {
+        output_pointer = ensure(output_buffer, 2);
+        if (output_pointer == NULL)
         {
-            *output_pointer++ = '\n';
+            return false;
         }
+        *output_pointer++ = ']';
         *output_pointer = '\0';
-        output_buffer->offset += length;
+        output_buffer->depth--;
 
-        current_item = current_item->next;
+        return true;
     }
 
     output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
@@ -1817,18 +3834,155 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
     return true;
 }
 
+/* Render a value to text. Arrays and objects are walked with an explicit stack of the ones that are open. */
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+{
+    item_stack open;
+    const cJSON *current = item;
+    const cJSON *parent = NULL;
+    cJSON_bool printed = false;
+
+    if ((item == NULL) || (output_buffer == NULL))
+    {
+        return false;
+    }
+    item_stack_init(&open);
+
+    for (;;)
+    {
+        if ((parent != NULL) && cJSON_IsObject(parent) && !print_name(current, output_buffer))
+        {
+            goto done;
+        }
+
+        if (cJSON_IsArray(current) || cJSON_IsObject(current))
+        {
+            if (!print_open(current, output_buffer))
+            {
+                goto done;
+            }
+            if (cJSON_Child(current) != NULL)
+            {
+                if (!item_stack_push(&open, current, &output_buffer->hooks))
+                {
+                    goto done;
+                }
+                parent = current;
+                current = cJSON_Child(current);
+                continue;
+            }
+            if (!print_close(current, output_buffer))
+            {
+                goto done;
+            }
+        }
+        else if (!print_scalar(current, output_buffer))
+        {
+            goto done;
+        }
+        update_offset(output_buffer);
+
+        /* close the arrays and objects that end after the value */
+        for (;;)
+        {
+            if (parent == NULL)
+            {
+                printed = true;
+                goto done;
+            }
+            if (!print_separator(parent, current, output_buffer))
+            {
+                goto done;
+            }
+            if (current->next != NULL)
+            {
+                break;
+            }
+
+            current = parent;
+            open.count--;
+            parent = (open.count > 0) ? item_stack_top(&open) : NULL;
+            if (!print_close(current, output_buffer))
+            {
+                goto done;
+            }
+            update_offset(output_buffer);
+        }
+        current = current->next;
+    }
+
+done:
+    item_stack_free(&open, &output_buffer->hooks);
+
+    return printed;
+}
+
+#ifdef CJSON_ARRAY_INDEX
+/* Build the vector over the children of a long array */
+static cJSON_Index *build_array_index(const cJSON * const array)
+{
+    cJSON_Index *index = NULL;
+    cJSON *child = NULL;
+    size_t count = 0;
+
+    for (child = cJSON_Child(array); child != NULL; child = child->next)
+    {
+        count++;
+    }
+    if ((count == 0) || (count < CJSON_INDEX_THRESHOLD))
+    {
+        return &small_index;
+    }
+
+    index = (cJSON_Index*)global_hooks.allocate(sizeof(cJSON_Index) + ((count - 1) * sizeof(cJSON*)));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    index->count = count;
+    index->mask = 0;
+    for (count = 0, child = cJSON_Child(array); child != NULL; child = child->next)
+    {
+        index->slots[count++] = child;
+    }
+
+    return index;
+}
+
+/* build the vector of an array on the first access */
+static void index_array(const cJSON * const array)
+{
+    /* references share their children with another array, only that one notices when they change */
+    if (((array->type & 0xFF) == cJSON_Array) && !(array->type & cJSON_IsReference))
+    {
+        ((cJSON*)cast_away_const(array))->index = build_array_index(array);
+    }
+}
+#endif
+
 /* Get Array size/item / object item. */
 CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array)
 {
     cJSON *child = NULL;
     size_t size = 0;
 
-    if (array == NULL)
+    if ((array == NULL) || !has_children(array))
     {
         return 0;
     }
 
-    child = array->child;
+#ifdef CJSON_ARRAY_INDEX
+    if (array->index == NULL)
+    {
+        index_array(array);
+    }
+    if (has_index(array) && ((array->type & 0xFF) == cJSON_Array))
+    {
+        return (int)array->index->count;
+    }
+#endif
+
+    child = cJSON_Child(array);
 
     while(child != NULL)
     {
@@ -1845,12 +3999,23 @@ static cJSON* get_array_item(const cJSON *array, size_t index)
 {
     cJSON *current_child = NULL;
 
-    if (array == NULL)
+    if ((array == NULL) || !has_children(array))
     {
         return NULL;
     }
 
-    current_child = array->child;
+#ifdef CJSON_ARRAY_INDEX
+    if (array->index == NULL)
+    {
+        index_array(array);
+    }
+    if (has_index(array) && ((array->type & 0xFF) == cJSON_Array))
+    {
+        return (index < array->index->count) ? array->index->slots[index] : NULL;
+    }
+#endif
+
+    current_child = cJSON_Child(array);
     while ((current_child != NULL) && (index > 0))
     {
         index--;
@@ -1870,19 +4035,105 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
+#ifdef CJSON_OBJECT_INDEX
+/* Build the index of a wide object. Children are inserted in list order, so keys that match the same lookup
+ * are probed in list order too and the first one found is the one a walk would find. */
+static cJSON_Index *build_index(const cJSON * const object)
+{
+    cJSON_Index *index = NULL;
+    const cJSON *child = NULL;
+    size_t count = 0;
+    size_t slots = 1;
+    size_t slot = 0;
+
+    for (child = cJSON_Child(object); child != NULL; child = child->next)
+    {
+        /* a walk stops at children without a name */
+        if (child->string == NULL)
+        {
+            return &small_index;
+        }
+        count++;
+    }
+    if ((count == 0) || (count < CJSON_INDEX_THRESHOLD))
+    {
+        return &small_index;
+    }
+
+    /* keep the table at most half full */
+    while (slots < (count * 2))
+    {
+        slots *= 2;
+    }
+
+    index = (cJSON_Index*)global_hooks.allocate(sizeof(cJSON_Index) + ((slots - 1) * sizeof(cJSON*)));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    memset(index->slots, '\0', slots * sizeof(cJSON*));
+    index->count = count;
+    index->mask = slots - 1;
+
+    for (child = cJSON_Child(object); child != NULL; child = child->next)
+    {
+        slot = hash_key((const unsigned char*)child->string, strlen(child->string)) & index->mask;
+        while (index->slots[slot] != NULL)
+        {
+            slot = (slot + 1) & index->mask;
+        }
+        index->slots[slot] = (cJSON*)cast_away_const(child);
+    }
+
+    return index;
+}
+
+static cJSON *index_lookup(const cJSON_Index * const index, const char * const name, const cJSON_bool case_sensitive)
+{
+    size_t slot = hash_key((const unsigned char*)name, strlen(name)) & index->mask;
+
+    while (index->slots[slot] != NULL)
+    {
+        if (case_sensitive ? ((name == index->slots[slot]->string) || (strcmp(name, index->slots[slot]->string) == 0)) : (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)index->slots[slot]->string) == 0))
+        {
+            return index->slots[slot];
+        }
+        slot = (slot + 1) & index->mask;
+    }
+
+    return NULL;
+}
+#endif
+
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
 
-    if ((object == NULL) || (name == NULL))
+    if ((object == NULL) || (name == NULL) || !has_children(object))
     {
         return NULL;
     }
 
-    current_element = object->child;
+#ifdef CJSON_OBJECT_INDEX
+    if ((object->type & 0xFF) == cJSON_Object)
+    {
+        /* references share their children with another object, only that one notices when they change */
+        if ((object->index == NULL) && !(object->type & cJSON_IsReference))
+        {
+            ((cJSON*)cast_away_const(object))->index = build_index(object);
+        }
+        if (has_index(object))
+        {
+            return index_lookup(object->index, name, case_sensitive);
+        }
+    }
+#endif
+
+    current_element = cJSON_Child(object);
     if (case_sensitive)
     {
-        while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
+        /* interned keys are found by comparing the pointers */
+        while ((current_element != NULL) && (current_element->string != NULL) && (current_element->string != name) && (strcmp(name, current_element->string) != 0))
         {
             current_element = current_element->next;
         }
@@ -1917,6 +4168,234 @@ CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *st
     return cJSON_GetObjectItem(object, string) ? 1 : 0;
 }
 
+/* read the next step of a path into step, copying its key into the selector. Returns a pointer behind the step or
+ * NULL if the path is malformed or the selector is full */
+static const char *compile_step(cJSON_Selector * const selector, const char *path, cJSON_SelectorStep * const step)
+{
+    size_t length = 0;
+
+    memset(step, '\0', sizeof(cJSON_SelectorStep));
+    if (path[0] == '[')
+    {
+        step->key = -1;
+        if ((path[1] == '*') && (path[2] == ']'))
+        {
+            step->any = true;
+            path += 3;
+        }
+        else
+        {
+            for (path++; (*path >= '0') && (*path <= '9'); path++)
+            {
+                step->index = (step->index * 10) + (size_t)(*path - '0');
+                length++;
+            }
+            if ((length == 0) || (*path != ']'))
+            {
+                return NULL;
+            }
+            path++;
+        }
+    }
+    else
+    {
+        length = strcspn(path, ".[");
+        if ((selector->key_size + length + sizeof("")) > sizeof(selector->keys))
+        {
+            return NULL;
+        }
+        step->key = (int)selector->key_size;
+        memcpy(selector->keys + selector->key_size, path, length);
+        selector->keys[selector->key_size + length] = '\0';
+        path += length;
+    }
+
+    if (*path == '.')
+    {
+        path++;
+    }
+
+    return path;
+}
+
+/* find the step below parent that selects the same as step, returns 0 if there is none */
+static unsigned char find_step(const cJSON_Selector * const selector, unsigned char parent, const cJSON_SelectorStep * const step)
+{
+    unsigned char current = selector->steps[parent].child;
+
+    for (; current != 0; current = selector->steps[current].next)
+    {
+        const cJSON_SelectorStep *other = &selector->steps[current];
+        if ((step->key >= 0) && (other->key >= 0))
+        {
+            if (strcmp(selector->keys + step->key, selector->keys + other->key) == 0)
+            {
+                return current;
+            }
+        }
+        else if ((step->key < 0) && (other->key < 0) && (step->any == other->any) && (step->index == other->index))
+        {
+            return current;
+        }
+    }
+
+    return 0;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CompileSelector(cJSON_Selector * const selector, const char * const *paths, int path_count)
+{
+    int i = 0;
+
+    if ((selector == NULL) || (path_count < 0) || ((size_t)path_count > (sizeof(unsigned long) * CHAR_BIT)) || ((paths == NULL) && (path_count > 0)))
+    {
+        return false;
+    }
+
+    memset(selector, '\0', sizeof(cJSON_Selector));
+    selector->step_count = 1;
+    selector->path_count = path_count;
+
+    for (i = 0; i < path_count; i++)
+    {
+        const char *path = paths[i];
+        unsigned char current = 0;
+
+        if (path == NULL)
+        {
+            return false;
+        }
+
+        while (*path != '\0')
+        {
+            cJSON_SelectorStep step;
+            unsigned char found = 0;
+            size_t key_size = selector->key_size;
+
+            path = compile_step(selector, path, &step);
+            if (path == NULL)
+            {
+                return false;
+            }
+
+            found = find_step(selector, current, &step);
+            if (found == 0)
+            {
+                if ((selector->step_count >= CJSON_SELECTOR_MAX_STEPS) || (selector->step_count > UCHAR_MAX))
+                {
+                    return false;
+                }
+                /* keep the key that was copied by compile_step, and add the step last among its siblings so matches
+                 * are reported in the order of the paths */
+                if (step.key >= 0)
+                {
+                    selector->key_size = key_size + strlen(selector->keys + step.key) + sizeof("");
+                }
+                found = (unsigned char)selector->step_count++;
+                selector->steps[found] = step;
+                if (selector->steps[current].child == 0)
+                {
+                    selector->steps[current].child = found;
+                }
+                else
+                {
+                    unsigned char last = selector->steps[current].child;
+                    while (selector->steps[last].next != 0)
+                    {
+                        last = selector->steps[last].next;
+                    }
+                    selector->steps[last].next = found;
+                }
+            }
+            current = found;
+        }
+
+        selector->steps[current].ends |= 1UL << i;
+    }
+
+    return true;
+}
+
+/* report the matches below item, which is selected by step, and then item itself */
+static void select_step(const cJSON_Selector * const selector, unsigned char step, const cJSON * const item, cJSON_StreamCallback callback, void *user_data)
+{
+    const cJSON_SelectorStep *current = &selector->steps[step];
+    unsigned char below = current->child;
+    int i = 0;
+
+    for (; below != 0; below = selector->steps[below].next)
+    {
+        const cJSON_SelectorStep *next = &selector->steps[below];
+        const cJSON *element = NULL;
+
+        if ((next->key >= 0) && cJSON_IsObject(item))
+        {
+            element = get_object_item(item, selector->keys + next->key, true);
+            if (element != NULL)
+            {
+                select_step(selector, below, element, callback, user_data);
+            }
+        }
+        else if ((next->key < 0) && next->any && cJSON_IsArray(item))
+        {
+            for (element = cJSON_Child(item); element != NULL; element = element->next)
+            {
+                select_step(selector, below, element, callback, user_data);
+            }
+        }
+        else if ((next->key < 0) && cJSON_IsArray(item))
+        {
+            element = get_array_item(item, next->index);
+            if (element != NULL)
+            {
+                select_step(selector, below, element, callback, user_data);
+            }
+        }
+    }
+
+    for (i = 0; i < selector->path_count; i++)
+    {
+        if (current->ends & (1UL << i))
+        {
+            callback(user_data, i, item);
+        }
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_Select(const cJSON_Selector * const selector, const cJSON * const item, cJSON_StreamCallback callback, void *user_data)
+{
+    if ((selector == NULL) || (item == NULL) || (callback == NULL))
+    {
+        return;
+    }
+
+    select_step(selector, 0, item, callback, user_data);
+}
+
+static void CJSON_CDECL keep_first_match(void *user_data, int path_index, const cJSON *item)
+{
+    const cJSON **first = (const cJSON**)user_data;
+    (void)path_index;
+
+    if (*first == NULL)
+    {
+        *first = item;
+    }
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_GetPath(const cJSON * const item, const char *path)
+{
+    cJSON_Selector selector;
+    const cJSON *first = NULL;
+
+    if (!cJSON_CompileSelector(&selector, &path, 1))
+    {
+        return NULL;
+    }
+    cJSON_Select(&selector, item, keep_first_match, &first);
+
+    return (cJSON*)cast_away_const(first);
+}
+
 /* Utility for array list handling. */
 static void suffix_object(cJSON *prev, cJSON *item)
 {
@@ -1940,6 +4419,9 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
     }
 
     memcpy(reference, item, sizeof(cJSON));
+#if defined(CJSON_OBJECT_INDEX) || defined(CJSON_ARRAY_INDEX)
+    reference->index = NULL;
+#endif
     reference->string = NULL;
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
@@ -1950,19 +4432,20 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
 {
     cJSON *child = NULL;
 
-    if ((item == NULL) || (array == NULL) || (array == item))
+    if ((item == NULL) || (array == NULL) || (array == item) || !has_children(array))
     {
         return false;
     }
 
-    child = array->child;
+    drop_index(array);
+    child = cJSON_Child(array);
     /*
      * To find the last item in array quickly, we use prev in array
      */
     if (child == NULL)
     {
         /* list is empty, start new one */
-        array->child = item;
+        cJSON_Child(array) = item;
         item->prev = item;
         item->next = NULL;
     }
@@ -1972,7 +4455,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         if (child->prev)
         {
             suffix_object(child->prev, item);
-            array->child->prev = item;
+            cJSON_Child(array)->prev = item;
         }
     }
 
@@ -2184,7 +4667,8 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         return NULL;
     }
 
-    if (item != parent->child)
+    drop_index(parent);
+    if (item != cJSON_Child(parent))
     {
         /* not the first element */
         item->prev->next = item->next;
@@ -2195,15 +4679,15 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         item->next->prev = item->prev;
     }
 
-    if (item == parent->child)
+    if (item == cJSON_Child(parent))
     {
         /* first element */
-        parent->child = item->next;
+        cJSON_Child(parent) = item->next;
     }
     else if (item->next == NULL)
     {
         /* last element */
-        parent->child->prev = item->prev;
+        cJSON_Child(parent)->prev = item->prev;
     }
 
     /* make sure the detached item doesn't point anywhere anymore */
@@ -2268,12 +4752,13 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
         return add_item_to_array(array, newitem);
     }
 
+    drop_index(array);
     newitem->next = after_inserted;
     newitem->prev = after_inserted->prev;
     after_inserted->prev = newitem;
-    if (after_inserted == array->child)
+    if (after_inserted == cJSON_Child(array))
     {
-        array->child = newitem;
+        cJSON_Child(array) = newitem;
     }
     else
     {
@@ -2294,6 +4779,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return true;
     }
 
+    drop_index(parent);
     replacement->next = item->next;
     replacement->prev = item->prev;
 
@@ -2301,13 +4787,13 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
     {
         replacement->next->prev = replacement;
     }
-    if (parent->child == item)
+    if (cJSON_Child(parent) == item)
     {
-        if (parent->child->prev == parent->child)
+        if (cJSON_Child(parent)->prev == cJSON_Child(parent))
         {
             replacement->prev = replacement;
         }
-        parent->child = replacement;
+        cJSON_Child(parent) = replacement;
     }
     else
     {   /*
@@ -2320,7 +4806,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         }
         if (replacement->next == NULL)
         {
-            parent->child->prev = replacement;
+            cJSON_Child(parent)->prev = replacement;
         }
     }
 
@@ -2420,21 +4906,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
     if(item)
     {
         item->type = cJSON_Number;
-        item->valuedouble = num;
-
-        /* use saturation in case of overflow */
-        if (num >= INT_MAX)
-        {
-            item->valueint = INT_MAX;
-        }
-        else if (num <= (double)INT_MIN)
-        {
-            item->valueint = INT_MIN;
-        }
-        else
-        {
-            item->valueint = (int)num;
-        }
+        cJSON_ValueDouble(item) = num;
+        set_valueint(item, saturate_int(num));
     }
 
     return item;
@@ -2446,8 +4919,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
     if(item)
     {
         item->type = cJSON_String;
-        item->valuestring = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
-        if(!item->valuestring)
+        cJSON_ValueString(item) = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
+        if(!cJSON_ValueString(item))
         {
             cJSON_Delete(item);
             return NULL;
@@ -2463,7 +4936,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringReference(const char *string)
     if (item != NULL)
     {
         item->type = cJSON_String | cJSON_IsReference;
-        item->valuestring = (char*)cast_away_const(string);
+        cJSON_ValueString(item) = (char*)cast_away_const(string);
     }
 
     return item;
@@ -2474,7 +4947,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if (item != NULL) {
         item->type = cJSON_Object | cJSON_IsReference;
-        item->child = (cJSON*)cast_away_const(child);
+        cJSON_Child(item) = (cJSON*)cast_away_const(child);
     }
 
     return item;
@@ -2484,7 +4957,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateArrayReference(const cJSON *child) {
     cJSON *item = cJSON_New_Item(&global_hooks);
     if (item != NULL) {
         item->type = cJSON_Array | cJSON_IsReference;
-        item->child = (cJSON*)cast_away_const(child);
+        cJSON_Child(item) = (cJSON*)cast_away_const(child);
     }
 
     return item;
@@ -2496,8 +4969,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw)
     if(item)
     {
         item->type = cJSON_Raw;
-        item->valuestring = (char*)cJSON_strdup((const unsigned char*)raw, &global_hooks);
-        if(!item->valuestring)
+        cJSON_ValueString(item) = (char*)cJSON_strdup((const unsigned char*)raw, &global_hooks);
+        if(!cJSON_ValueString(item))
         {
             cJSON_Delete(item);
             return NULL;
@@ -2554,7 +5027,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateIntArray(const int *numbers, int count)
         }
         if(!i)
         {
-            a->child = n;
+            cJSON_Child(a) = n;
         }
         else
         {
@@ -2563,8 +5036,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateIntArray(const int *numbers, int count)
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
+    if (a && cJSON_Child(a)) {
+        cJSON_Child(a)->prev = n;
     }
 
     return a;
@@ -2594,7 +5067,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateFloatArray(const float *numbers, int count)
         }
         if(!i)
         {
-            a->child = n;
+            cJSON_Child(a) = n;
         }
         else
         {
@@ -2603,8 +5076,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateFloatArray(const float *numbers, int count)
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
+    if (a && cJSON_Child(a)) {
+        cJSON_Child(a)->prev = n;
     }
 
     return a;
@@ -2634,7 +5107,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateDoubleArray(const double *numbers, int count)
         }
         if(!i)
         {
-            a->child = n;
+            cJSON_Child(a) = n;
         }
         else
         {
@@ -2643,8 +5116,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateDoubleArray(const double *numbers, int count)
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
+    if (a && cJSON_Child(a)) {
+        cJSON_Child(a)->prev = n;
     }
 
     return a;
@@ -2674,7 +5147,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int co
         }
         if(!i)
         {
-            a->child = n;
+            cJSON_Child(a) = n;
         }
         else
         {
@@ -2683,26 +5156,18 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int co
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
+    if (a && cJSON_Child(a)) {
+        cJSON_Child(a)->prev = n;
     }
     
     return a;
 }
 
-/* Duplication */
-CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
+/* Duplication of one item without its children */
+static cJSON *duplicate_item(const cJSON * const item)
 {
     cJSON *newitem = NULL;
-    cJSON *child = NULL;
-    cJSON *next = NULL;
-    cJSON *newchild = NULL;
 
-    /* Bail on bad ptr */
-    if (!item)
-    {
-        goto fail;
-    }
     /* Create new item */
     newitem = cJSON_New_Item(&global_hooks);
     if (!newitem)
@@ -2711,12 +5176,15 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     }
     /* Copy over all vars */
     newitem->type = item->type & (~cJSON_IsReference);
-    newitem->valueint = item->valueint;
-    newitem->valuedouble = item->valuedouble;
-    if (item->valuestring)
+    set_valueint(newitem, item->valueint);
+    if (has_valuedouble(item))
+    {
+        cJSON_ValueDouble(newitem) = cJSON_ValueDouble(item);
+    }
+    if (has_valuestring(item) && (cJSON_ValueString(item) != NULL))
     {
-        newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
-        if (!newitem->valuestring)
+        cJSON_ValueString(newitem) = (char*)cJSON_strdup((unsigned char*)cJSON_ValueString(item), &global_hooks);
+        if (!cJSON_ValueString(newitem))
         {
             goto fail;
         }
@@ -2729,47 +5197,94 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
             goto fail;
         }
     }
+
+    return newitem;
+
+fail:
+    if (newitem != NULL)
+    {
+        cJSON_Delete(newitem);
+    }
+
+    return NULL;
+}
+
+/* Duplication, walking the children with an explicit stack of the arrays and objects that are being copied */
+CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
+{
+    item_stack open; /* each array or object is followed by its copy */
+    const cJSON *current = item;
+    cJSON *newitem = NULL;
+    cJSON *copy = NULL; /* of current */
+    cJSON *newchild = NULL;
+
+    /* Bail on bad ptr */
+    if (!item)
+    {
+        return NULL;
+    }
+    newitem = duplicate_item(item);
     /* If non-recursive, then we're done! */
-    if (!recurse)
+    if ((newitem == NULL) || !recurse)
     {
         return newitem;
     }
-    /* Walk the ->next chain for the child. */
-    child = item->child;
-    while (child != NULL)
+
+    item_stack_init(&open);
+    copy = newitem;
+    for (;;)
     {
-        newchild = cJSON_Duplicate(child, true); /* Duplicate (with recurse) each item in the ->next chain */
-        if (!newchild)
+        if (has_children(current) && (cJSON_Child(current) != NULL))
         {
-            goto fail;
+            /* Set copy->child and move to it */
+            if (!item_stack_push(&open, current, &global_hooks) || !item_stack_push(&open, copy, &global_hooks))
+            {
+                goto fail;
+            }
+            current = cJSON_Child(current);
+            newchild = duplicate_item(current);
+            if (!newchild)
+            {
+                goto fail;
+            }
+            cJSON_Child(copy) = newchild;
+            newchild->prev = newchild;
+            copy = newchild;
+            continue;
         }
-        if (next != NULL)
+
+        /* Walk the ->next chain, back up to the array or object that has one left */
+        while ((open.count > 0) && (current->next == NULL))
         {
-            /* If newitem->child already set, then crosswire ->prev and ->next and move on */
-            next->next = newchild;
-            newchild->prev = next;
-            next = newchild;
+            copy = (cJSON*)cast_away_const(item_stack_top(&open));
+            open.count--;
+            current = item_stack_top(&open);
+            open.count--;
         }
-        else
+        if (open.count == 0)
         {
-            /* Set newitem->child and move to it */
-            newitem->child = newchild;
-            next = newchild;
+            break;
         }
-        child = child->next;
-    }
-    if (newitem && newitem->child)
-    {
-        newitem->child->prev = newchild;
+
+        current = current->next;
+        newchild = duplicate_item(current);
+        if (!newchild)
+        {
+            goto fail;
+        }
+        /* crosswire ->prev and ->next, the first child links to the last one */
+        copy->next = newchild;
+        newchild->prev = copy;
+        cJSON_Child(((cJSON*)cast_away_const(item_stack_top(&open))))->prev = newchild;
+        copy = newchild;
     }
+    item_stack_free(&open, &global_hooks);
 
     return newitem;
 
 fail:
-    if (newitem != NULL)
-    {
-        cJSON_Delete(newitem);
-    }
+    item_stack_free(&open, &global_hooks);
+    cJSON_Delete(newitem);
 
     return NULL;
 }
@@ -2801,24 +5316,38 @@ static void skip_multiline_comment(char **input)
     }
 }
 
-static void minify_string(char **input, char **output) {
+static void minify_string(char **input, char **output, const char * const end) {
     (*output)[0] = (*input)[0];
     *input += static_strlen("\"");
     *output += static_strlen("\"");
 
 
-    for (; (*input)[0] != '\0'; (void)++(*input), ++(*output)) {
-        (*output)[0] = (*input)[0];
+    while (*input < end) {
+        /* move everything up to the next quote or escape sequence at once */
+        const char *run_end = (const char*)scan_string((const unsigned char*)*input, (const unsigned char*)end);
+        if (*output != *input) {
+            memmove(*output, *input, (size_t)(run_end - *input));
+        }
+        *output += run_end - *input;
+        *input += run_end - *input;
+        if (*input == end) {
+            return;
+        }
 
+        (*output)[0] = (*input)[0];
         if ((*input)[0] == '\"') {
-            (*output)[0] = '\"';
             *input += static_strlen("\"");
             *output += static_strlen("\"");
             return;
-        } else if (((*input)[0] == '\\') && ((*input)[1] == '\"')) {
-            (*output)[1] = (*input)[1];
-            *input += static_strlen("\"");
-            *output += static_strlen("\"");
+        }
+
+        /* keep the escaped character, which may be a quote or another backslash */
+        *input += static_strlen("\\");
+        *output += static_strlen("\\");
+        if (*input < end) {
+            (*output)[0] = (*input)[0];
+            *input += 1;
+            *output += 1;
         }
     }
 }
@@ -2826,12 +5355,15 @@ static void minify_string(char **input, char **output) {
 CJSON_PUBLIC(void) cJSON_Minify(char *json)
 {
     char *into = json;
+    const char *end = NULL;
 
     if (json == NULL)
     {
         return;
     }
 
+    end = json + strlen(json);
+
     while (json[0] != '\0')
     {
         switch (json[0])
@@ -2857,7 +5389,7 @@ CJSON_PUBLIC(void) cJSON_Minify(char *json)
                 break;
 
             case '\"':
-                minify_string(&json, (char**)&into);
+                minify_string(&json, (char**)&into, end);
                 break;
 
             default:
@@ -3010,7 +5542,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             return true;
 
         case cJSON_Number:
-            if (compare_double(a->valuedouble, b->valuedouble))
+            if (compare_double(cJSON_ValueDouble(a), cJSON_ValueDouble(b)))
             {
                 return true;
             }
@@ -3018,11 +5550,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
 
         case cJSON_String:
         case cJSON_Raw:
-            if ((a->valuestring == NULL) || (b->valuestring == NULL))
+            if ((cJSON_ValueString(a) == NULL) || (cJSON_ValueString(b) == NULL))
             {
                 return false;
             }
-            if (strcmp(a->valuestring, b->valuestring) == 0)
+            if (strcmp(cJSON_ValueString(a), cJSON_ValueString(b)) == 0)
             {
                 return true;
             }
@@ -3031,8 +5563,8 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
 
         case cJSON_Array:
         {
-            cJSON *a_element = a->child;
-            cJSON *b_element = b->child;
+            cJSON *a_element = cJSON_Child(a);
+            cJSON *b_element = cJSON_Child(b);
 
             for (; (a_element != NULL) && (b_element != NULL);)
             {
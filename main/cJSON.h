@@ -77,6 +77,9 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 
 #include <stddef.h>
 
+/* options that change the layout of struct cJSON */
+#include "cJSON_config.h"
+
 /* cJSON Types: */
 #define cJSON_Invalid (0)
 #define cJSON_False  (1 << 0)
@@ -97,23 +100,55 @@ typedef struct cJSON
     /* next/prev allow you to walk array/object chains. Alternatively, use GetArraySize/GetArrayItem/GetObjectItem */
     struct cJSON *next;
     struct cJSON *prev;
+#ifdef CJSON_COMPACT_NODES
+    /* child, valuestring and valuedouble share their storage, only the one that belongs to the type is valid.
+     * There is no valueint, cJSON_GetIntValue works it out from valuedouble. */
+    union
+    {
+        struct cJSON *child;
+        char *valuestring;
+        double valuedouble;
+    } value;
+#else
     /* An array or object item will have a child pointer pointing to a chain of the items in the array/object. */
     struct cJSON *child;
+#endif
 
     /* The type of the item, as above. */
     int type;
 
+#ifndef CJSON_COMPACT_NODES
     /* The item's string, if type==cJSON_String  and type == cJSON_Raw */
     char *valuestring;
     /* writing to valueint is DEPRECATED, use cJSON_SetNumberValue instead */
     int valueint;
     /* The item's number, if type==cJSON_Number */
     double valuedouble;
+#endif
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+#if defined(CJSON_OBJECT_INDEX) || defined(CJSON_ARRAY_INDEX)
+    /* private: table over the children of an object or array, see CJSON_INDEX_THRESHOLD */
+    struct cJSON_Index *index;
+#endif
 } cJSON;
 
+/* child, valuestring, valuedouble and valueint of an item with either layout. All but cJSON_ValueInt can be assigned
+ * to as well, set numbers with cJSON_SetNumberValue. */
+#ifdef CJSON_COMPACT_NODES
+#define cJSON_Child(item) ((item)->value.child)
+#define cJSON_ValueString(item) ((item)->value.valuestring)
+#define cJSON_ValueDouble(item) ((item)->value.valuedouble)
+#define cJSON_ValueInt(item) cJSON_GetIntValue(item)
+#else
+#define cJSON_Child(item) ((item)->child)
+#define cJSON_ValueString(item) ((item)->valuestring)
+#define cJSON_ValueDouble(item) ((item)->valuedouble)
+#define cJSON_ValueInt(item) ((item)->valueint)
+#endif
+
 typedef struct cJSON_Hooks
 {
       /* malloc/free are CDECL on Windows regardless of the default calling convention of the compiler, so ensure the hooks allow passing those functions directly. */
@@ -123,17 +158,188 @@ typedef struct cJSON_Hooks
 
 typedef int cJSON_bool;
 
-/* Limits how deeply nested arrays/objects can be before cJSON rejects to parse them.
- * This is to prevent stack overflows. */
+/* Limits how deeply nested arrays/objects can be before cJSON rejects to parse them. Parsing, printing, duplicating
+ * and deleting don't recurse, so the stack they use doesn't depend on it. */
 #ifndef CJSON_NESTING_LIMIT
 #define CJSON_NESTING_LIMIT 1000
 #endif
 
+/* Define CJSON_OBJECT_INDEX in cJSON_config.h to look up keys of objects with at least
+ * CJSON_INDEX_THRESHOLD children through a hash table instead of walking them. The table is built by the first
+ * lookup and dropped when the children are changed through the cJSON functions, so keys must not be changed
+ * by writing to item->string directly. Objects parsed into an arena are never indexed. Objects below the
+ * threshold remember that they are too small, so repeated lookups in them don't count their children again.
+ * Because the first lookup writes the table (or that mark) into the object, lookups through a const cJSON* are
+ * not safe to run from several threads at once; do one lookup in every indexed object before sharing a document.
+ * CJSON_ARRAY_INDEX does the same for arrays with a vector of the children, which makes cJSON_GetArrayItem and
+ * cJSON_GetArraySize O(1). The vector (or the mark that the array is too small) is built by the first of them,
+ * so the children must only be changed through the cJSON functions as well, and the same warning about threads
+ * applies. */
+#ifndef CJSON_INDEX_THRESHOLD
+#define CJSON_INDEX_THRESHOLD 8
+#endif
+
+/* Define CJSON_COMPACT_NODES in cJSON_config.h to let child, valuestring and valuedouble share one union and to
+ * drop valueint. A node then takes 24 instead of 40 bytes on 32 bit targets with 8 byte aligned doubles like the
+ * ESP32, and 40 instead of 64 on 64 bit ones. The fields are only reachable through cJSON_Child, cJSON_ValueString,
+ * cJSON_ValueDouble and cJSON_ValueInt, and only the one that belongs to the type of the item may be read:
+ * valuestring of strings and raw items, valuedouble and valueint of numbers and child of arrays and objects. The
+ * cJSON functions already do, refuse to add items to anything that is not an array or object and only set the
+ * number of number items.
+ * next and prev stay pointers. The double keeps a 32 bit node 8 byte aligned, so without prev it would still take
+ * 24 bytes, and 16 bit arena offsets instead of pointers would only work for documents in an arena while every
+ * walk over next and child, in cJSON and in its callers, would need the arena to follow them. */
+
+/* Limits for the streaming parser (cJSON_InitStream). Everything is kept inside cJSON_Stream,
+ * so these decide its size. */
+#ifndef CJSON_STREAM_MAX_PATHS
+#define CJSON_STREAM_MAX_PATHS 8
+#endif
+#ifndef CJSON_STREAM_NESTING_LIMIT
+#define CJSON_STREAM_NESTING_LIMIT 32
+#endif
+/* strings and numbers at requested paths have to fit in here (including the terminating zero) */
+#ifndef CJSON_STREAM_TOKEN_SIZE
+#define CJSON_STREAM_TOKEN_SIZE 64
+#endif
+
+/* Called for every value at one of the requested paths. item is only valid during the call, arrays and
+ * objects are reported without children once their closing bracket has been read. */
+typedef void (CJSON_CDECL *cJSON_StreamCallback)(void *user_data, int path_index, const cJSON *item);
+
+/* Receives the output of cJSON_PrintToSink piece by piece. data is not zero terminated, return 0 to stop printing. */
+typedef cJSON_bool (CJSON_CDECL *cJSON_PrintSink)(void *user_data, const char *data, size_t length);
+
+typedef struct cJSON_StreamLevel
+{
+    unsigned long matching; /* bit per path that still matches at this level */
+    size_t index; /* current element for arrays */
+    unsigned char position[CJSON_STREAM_MAX_PATHS]; /* how far each path has been matched */
+    unsigned char type;
+} cJSON_StreamLevel;
+
+/* State of a streaming parse. Allocate it wherever is convenient, the members are private except for offset. */
+typedef struct cJSON_Stream
+{
+    const char *paths[CJSON_STREAM_MAX_PATHS];
+    int path_count;
+    cJSON_StreamCallback callback;
+    void *user_data;
+    /* number of bytes consumed, points at the offending byte after cJSON_FeedStream failed */
+    size_t offset;
+    int state;
+    int string_state;
+    cJSON_bool capture; /* the string that is being read is at a requested path */
+    size_t depth;
+    /* paths matching the value that is about to be parsed */
+    unsigned long pending;
+    unsigned char pending_position[CJSON_STREAM_MAX_PATHS];
+    size_t key_length;
+    const char *literal;
+    size_t literal_length;
+    unsigned char escape[12];
+    size_t escape_length;
+    unsigned char token[CJSON_STREAM_TOKEN_SIZE];
+    size_t token_length;
+    cJSON_StreamLevel levels[CJSON_STREAM_NESTING_LIMIT];
+} cJSON_Stream;
+
+/* Limits for compiled paths (cJSON_CompileSelector). Paths sharing a prefix share its steps. */
+#ifndef CJSON_SELECTOR_MAX_STEPS
+#define CJSON_SELECTOR_MAX_STEPS 32
+#endif
+/* room for the keys of all steps (including a terminating zero each) */
+#ifndef CJSON_SELECTOR_KEY_SIZE
+#define CJSON_SELECTOR_KEY_SIZE 256
+#endif
+
+/* One key or array element of a compiled path. steps[0] of a selector is the document itself. */
+typedef struct cJSON_SelectorStep
+{
+    int key; /* offset of the key in cJSON_Selector.keys, -1 for array elements */
+    int any; /* [*] */
+    size_t index; /* [index] */
+    unsigned long ends; /* bit per path that ends at this step */
+    unsigned char child; /* first step below this one, 0 if there is none */
+    unsigned char next; /* next step below the same parent, 0 if there is none */
+} cJSON_SelectorStep;
+
+/* A set of paths compiled into a tree of steps. The members are private. */
+typedef struct cJSON_Selector
+{
+    cJSON_SelectorStep steps[CJSON_SELECTOR_MAX_STEPS];
+    int step_count;
+    int path_count;
+    char keys[CJSON_SELECTOR_KEY_SIZE];
+    size_t key_size;
+} cJSON_Selector;
+
+/* Slots of the table of interned keys, a power of 2. One of them stays empty. */
+#ifndef CJSON_KEYS_SLOTS
+#define CJSON_KEYS_SLOTS 64
+#endif
+
+/* Keys of objects that the documents parsed by cJSON_ParseWithKeys share. The members are private. */
+typedef struct cJSON_Keys
+{
+    char *buffer;
+    size_t size;
+    size_t used;
+    size_t count;
+    const char *slots[CJSON_KEYS_SLOTS];
+} cJSON_Keys;
+
+/* Region of memory a whole document is carved out of by cJSON_ParseInArena. The members are private. */
+typedef struct cJSON_Arena
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t used;
+} cJSON_Arena;
+
+/* Counters of what cJSON costs, kept when cJSON.c is compiled with CJSON_STATS. Reset them before an operation
+ * and read them after it to measure it, e.g. from a benchmark on the host. */
+typedef struct cJSON_Stats
+{
+    size_t allocations; /* successful calls of the malloc hook */
+    size_t deallocations; /* calls of the free hook */
+    size_t reallocations; /* successful calls of realloc */
+    size_t allocated_bytes; /* requested by all allocations and reallocations */
+    size_t items; /* cJSON items created, including those in arenas */
+} cJSON_Stats;
+
+/* State of the pool of deleted items that new items are taken from, see cJSON_SetItemPoolLimit. */
+typedef struct cJSON_PoolStats
+{
+    size_t items; /* items in the pool right now */
+    size_t peak; /* most items that were ever in the pool */
+    size_t hits; /* new items that were taken from the pool */
+    size_t misses; /* new items that had to be allocated while the pool was enabled */
+} cJSON_PoolStats;
+
+/* Parser state owned by the caller instead of being global, see cJSON_ParseWithContext. Set up with cJSON_InitContext,
+ * then nesting_limit may be changed. */
+typedef struct cJSON_Context
+{
+    cJSON_Hooks hooks; /* allocate and free the documents parsed with this context */
+    size_t nesting_limit; /* deepest nesting of arrays/objects that is accepted, each level costs stack */
+    const char *error; /* where the last parse with this context failed, NULL if it succeeded */
+    cJSON_Stats stats; /* what the parses and deletes with this context cost, counted even without CJSON_STATS */
+} cJSON_Context;
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
 /* Supply malloc, realloc and free functions to cJSON */
 CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks);
+/* Copies the counters into stats. Returns 0 and leaves stats alone if cJSON.c was built without CJSON_STATS. */
+CJSON_PUBLIC(cJSON_bool) cJSON_GetStats(cJSON_Stats * const stats);
+CJSON_PUBLIC(void) cJSON_ResetStats(void);
+/* Keep up to limit deleted items for reuse by the next parse or create instead of freeing them, 0 (the default)
+ * turns this off. Lowering the limit frees what is above it, cJSON_InitHooks empties the pool. The pool is global
+ * like the hooks, so only enable it while cJSON is used from one task at a time. */
+CJSON_PUBLIC(void) cJSON_SetItemPoolLimit(size_t limit);
+CJSON_PUBLIC(void) cJSON_GetItemPoolStats(cJSON_PoolStats * const stats);
 
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. */
@@ -144,6 +350,40 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Streaming parse: feed a document in chunks of any size and get a callback for every value at one of the paths,
+ * without allocating anything. Paths are keys separated by '.' with [*] or [index] selecting array elements,
+ * e.g. "data.conditions[*].am.rating". paths must stay valid until the stream is finished.
+ * cJSON_FeedStream returns 0 on a syntax error, cJSON_FinishStream returns 1 if exactly one complete value was fed. */
+CJSON_PUBLIC(cJSON_bool) cJSON_InitStream(cJSON_Stream * const stream, const char * const *paths, int path_count, cJSON_StreamCallback callback, void *user_data);
+CJSON_PUBLIC(cJSON_bool) cJSON_FeedStream(cJSON_Stream * const stream, const char *chunk, size_t length);
+CJSON_PUBLIC(cJSON_bool) cJSON_FinishStream(cJSON_Stream * const stream);
+
+/* Arena parse: every node and string of the document is taken from the size bytes at buffer instead of the hooks,
+ * and all documents parsed into the arena are released at once by cJSON_ResetArena. They must not be passed to
+ * cJSON_Delete or to anything else that frees or reallocates their items. A failed parse, including running out of
+ * space, returns NULL and leaves the arena as it was. */
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena * const arena, void *buffer, size_t size);
+CJSON_PUBLIC(void) cJSON_ResetArena(cJSON_Arena * const arena);
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(cJSON_Arena * const arena, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* In-situ parse: strings are unescaped in place and the keys and valuestrings of the document point into value, so
+ * only the items are allocated. value is overwritten even if the parse fails and has to outlive the document and any
+ * duplicate of it, string values are flagged cJSON_IsReference and keys cJSON_StringIsConst. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* Interned keys: names of object members are stored once in the size bytes at buffer and shared by all documents
+ * parsed with keys, flagged cJSON_StringIsConst. Names that don't fit any more are copied as usual. buffer and keys
+ * have to outlive the documents and their duplicates, cJSON_InitKeys starts over. cJSON_InternKey returns the
+ * shared copy of key, which cJSON_GetObjectItemCaseSensitive finds by comparing pointers, or NULL if it doesn't fit. */
+CJSON_PUBLIC(void) cJSON_InitKeys(cJSON_Keys * const keys, void *buffer, size_t size);
+CJSON_PUBLIC(const char *) cJSON_InternKey(cJSON_Keys * const keys, const char *key);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithKeys(cJSON_Keys * const keys, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* Context parse: allocations, the error position, the nesting limit and the counters are those of context, so tasks
+ * that each use their own context can parse at the same time. hooks may be NULL to use malloc and free. Documents
+ * must be deleted with cJSON_DeleteWithContext and the same context. Everything else, including lookups that
+ * build a CJSON_OBJECT_INDEX or CJSON_ARRAY_INDEX table, still goes through the global hooks. */
+CJSON_PUBLIC(void) cJSON_InitContext(cJSON_Context * const context, const cJSON_Hooks * const hooks);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithContext(cJSON_Context * const context, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+CJSON_PUBLIC(void) cJSON_DeleteWithContext(cJSON_Context * const context, cJSON *item);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -153,6 +393,11 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Render a cJSON entity to sink through the window_size bytes at window, without allocating unless arrays/objects
+ * are nested more than 16 levels deep. The window is handed to sink whenever it is full and once more at the end.
+ * Long strings are split, but a number (up to 26 bytes), a raw item or the indentation of a formatted line has to
+ * fit into the window, so use at least a few dozen bytes. */
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintToSink(const cJSON *item, cJSON_bool format, char *window, size_t window_size, cJSON_PrintSink sink, void *user_data);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
@@ -164,12 +409,28 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+
+/* Paths use the syntax of cJSON_InitStream, keys are case sensitive. cJSON_CompileSelector turns up to one path per
+ * bit of an unsigned long into a selector once, cJSON_Select then calls callback for every match of any of them in a
+ * single walk over item. Array elements are visited in order and matches below the same item are reported in the order
+ * of the paths, arrays and objects after the matches inside them. cJSON_GetPath returns the first item at a single
+ * path or NULL. */
+CJSON_PUBLIC(cJSON_bool) cJSON_CompileSelector(cJSON_Selector * const selector, const char * const *paths, int path_count);
+CJSON_PUBLIC(void) cJSON_Select(const cJSON_Selector * const selector, const cJSON * const item, cJSON_StreamCallback callback, void *user_data);
+CJSON_PUBLIC(cJSON *) cJSON_GetPath(const cJSON * const item, const char *path);
+/* Filtered parse: like cJSON_ParseWithLengthOpts, but only the items on or below a path of selector are built, the
+ * rest of the input is skipped without allocating (unless it nests deeper than 256 levels). Skipped values are checked
+ * like parsed ones, except that escapes in skipped strings are not decoded, so only the end of a string has to be
+ * there. Skipped array elements before a kept one are left as cJSON_NULL so indexes stay the same. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseSelected(const cJSON_Selector * const selector, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 
 /* Check item type and return its value */
 CJSON_PUBLIC(char *) cJSON_GetStringValue(const cJSON * const item);
 CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item);
+/* valueint: the number saturated to an int, 1 for true and 0 for anything else */
+CJSON_PUBLIC(int) cJSON_GetIntValue(const cJSON * const item);
 
 /* These functions check the type of an item */
 CJSON_PUBLIC(cJSON_bool) cJSON_IsInvalid(const cJSON * const item);
@@ -264,7 +525,12 @@ CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char *
 CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * const name);
 
 /* When assigning an integer value, it needs to be propagated to valuedouble too. */
+#ifdef CJSON_COMPACT_NODES
+/* valuedouble shares its storage with child and valuestring, so only numbers take the value */
+#define cJSON_SetIntValue(object, number) (((object) && ((object)->type & cJSON_Number)) ? cJSON_ValueDouble(object) = (number) : (number))
+#else
 #define cJSON_SetIntValue(object, number) ((object) ? (object)->valueint = (object)->valuedouble = (number) : (number))
+#endif
 /* helper for the cJSON_SetNumberValue macro */
 CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number);
 #define cJSON_SetNumberValue(object, number) ((object != NULL) ? cJSON_SetNumberHelper(object, (double)number) : (number))
@@ -272,7 +538,7 @@ CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number);
 CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring);
 
 /* Macro for iterating over an array or object */
-#define cJSON_ArrayForEach(element, array) for(element = (array != NULL) ? (array)->child : NULL; element != NULL; element = element->next)
+#define cJSON_ArrayForEach(element, array) for(element = (array != NULL) ? cJSON_Child(array) : NULL; element != NULL; element = element->next)
 
 /* malloc/free objects using the malloc/free functions that have been set with cJSON_InitHooks */
 CJSON_PUBLIC(void *) cJSON_malloc(size_t size);
@@ -0,0 +1,13 @@
+#ifndef cJSON_config__h
+#define cJSON_config__h
+
+/* Build options of cJSON that change the layout of struct cJSON. cJSON.h includes this file, so every file
+ * that uses cJSON sees the same struct. Enable them here (or for the whole build at once), never for single
+ * files: a file compiled with a different layout reads the wrong fields of every item it is handed.
+ * See cJSON.h for what each of them does. */
+
+/* #define CJSON_COMPACT_NODES */
+/* #define CJSON_OBJECT_INDEX */
+/* #define CJSON_ARRAY_INDEX */
+
+#endif
@@ -11,6 +11,7 @@
  * 
  */
 
+#include <ctype.h>
 #include <string.h>
 #include <time.h>
 #include "freertos/FreeRTOS.h"
@@ -19,6 +20,7 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "lwip/err.h"
@@ -27,6 +29,8 @@
 #include "lwip/netdb.h"
 #include "lwip/dns.h"
 
+#include "esp32/rom/miniz.h"
+
 #include "cJSON.h"
 #include "led_strip.c"
 #include "ssd1306_util.c"
@@ -35,30 +39,62 @@
 
 /* Long range not sure if this solution would works as the surline API is not 
  * documented and can be changed at any time without notice */
-#define WEB_SERVER "services.surfline.com"  // surfline api host
-#define WEB_PORT "80"                       // http port
-/* oceanside spot ID */
-//#define WEB_PATH "/kbyg/regions/forecasts/conditions?subregionId=58581a836630e24c44878fd7&days=1"
-
-/* slo spot ID */
-#define WEB_PATH "/kbyg/regions/forecasts/conditions?subregionId=58581a836630e24c44879014&days=1"
-
-/* South Carolina spot ID */
-//#define WEB_PATH "/kbyg/regions/forecasts/conditions?subregionId=58581a836630e24c44878fdf&days=1"
-
-/* cayucos spot ID because it is always poor to fair */
-//#define WEB_PATH "/kbyg/regions/forecasts/conditions?subregionId=5842041f4e65fad6a77089a2&days=1"
-
-#define DELAY_TIME  10000   // 10 second delay time between each get request
-
-#define BUFFER_SIZE 2048    // 2048 byte character buffer
+#define WEB_SERVER CONFIG_SURFLINE_SERVER   // surfline api host
+#define WEB_PORT CONFIG_SURFLINE_PORT       // http port
+#define WEB_PATH "/kbyg/regions/forecasts/conditions?subregionId=%s&days=1"
+
+/* a surfline subregion the clock keeps track of */
+typedef struct Spot {
+    const char *name;
+    const char *id;     // subregionId in the surfline api
+} Spot;
+
+/* all spots are fetched at the same time, the first one is shown on the
+   LED strip and OLED and the others are only logged */
+static const Spot SPOTS[] = {
+    {"slo",             "58581a836630e24c44879014"},
+    {"oceanside",       "58581a836630e24c44878fd7"},
+    {"south carolina",  "58581a836630e24c44878fdf"},
+    // cayucos because it is always poor to fair
+    {"cayucos",         "5842041f4e65fad6a77089a2"},
+};
+
+#define SPOT_COUNT  (sizeof(SPOTS) / sizeof(SPOTS[0]))
+
+/* the forecast only changes a few times a day, how long a response stays
+   current comes from its Cache-Control or Expires header */
+#define POLL_TIME       600000      // 10 minutes if the server doesn't say
+#define MIN_POLL_TIME   60000       // never more than once a minute
+#define MAX_POLL_TIME   10800000    // and at least every 3 hours
+#define POLL_JITTER     10          // up to 10% added so clocks don't poll in step
+#define RETRY_TIME      10000       // first retry after an error, doubles each time
+#define MAX_RETRY_TIME  900000      // 15 minutes at most between retries
+#define SOCKET_TIMEOUT 5000 // 5 seconds without progress on a socket
+
+#define DNS_CACHE_TTL   300000  // 5 minutes before the server is looked up again
+#define DNS_RETRY_TIME  60000   // 1 minute on the last address after a failed lookup
+
+#define BUFFER_SIZE 2048    // holds the HTTP header, the body streams through it
 
 static const char *T = "JSON Parser";
 
-static const char *REQUEST = "GET " WEB_PATH " HTTP/1.0\r\n"
+/* the fixed part of the request with the subregionId left open,
+   build_request adds Accept-Encoding and the conditional headers */
+static const char *REQUEST = "GET " WEB_PATH " HTTP/1.1\r\n"
     "Host: "WEB_SERVER":"WEB_PORT"\r\n"
     "User-Agent: esp-idf/1.0 esp32\r\n"
-    "\r\n";
+    "Connection: keep-alive\r\n";
+
+#define VALIDATOR_SIZE 64   // longest ETag or Last-Modified that is kept
+
+// hour * 60 + minute of the time on the OLED, -1 before anything is shown
+static int shown_time = -1;
+
+/* results of reading a response */
+#define RESPONSE_OK     0
+#define RESPONSE_ERROR  -1
+#define RESPONSE_CLOSED -2  // closed before anything was received
+#define RESPONSE_MORE   1   // waiting for more from the socket
 
 /* takes in a rating string from the surfline api and returns the correct 
    Rating struct filled out
@@ -123,278 +159,1326 @@ Rating calculate_rating(char *r)
     return rating;
 }
 
-/* takes in a string and uses CJSON to parse objects, for now prints to 
-    terminal */
-void parse_json(char *recv_buf, int recv_len, led_strip_t *strip)
+/* the values of the JSON the clock cares about, the index of each path is
+   what the stream parser hands to handle_report */
+#define RATING_PATH     0
+#define MAX_HEIGHT_PATH 1
+#define MIN_HEIGHT_PATH 2
+#define AM_PATH         3
+
+static const char *PATHS[] = {
+    "data.conditions[*].am.rating",
+    "data.conditions[*].am.maxHeight",
+    "data.conditions[*].am.minHeight",
+    "data.conditions[*].am",
+};
+
+// bits in Report.found for every value of the morning report
+#define FOUND_RATING        (1 << RATING_PATH)
+#define FOUND_MAX_HEIGHT    (1 << MAX_HEIGHT_PATH)
+#define FOUND_MIN_HEIGHT    (1 << MIN_HEIGHT_PATH)
+#define FOUND_ALL           (FOUND_RATING | FOUND_MAX_HEIGHT | FOUND_MIN_HEIGHT)
+
+/* the morning report of a condition, filled in while the JSON streams in and
+   shown once the "am" object has been closed */
+typedef struct Report {
+    const Spot *spot;
+    led_strip_t *strip;     // NULL unless the spot is the one on display
+    struct tm time;
+    char rating[MAX_COMP_LONG + 1];
+    int max_height;
+    int min_height;
+    uint8_t found;
+    int64_t shown;          // esp_timer_get_time() once it was shown
+} Report;
+
+/* finds the header called name in the null terminated HTTP header block and
+   returns a pointer to its value, or NULL if the header is not present */
+static const char *find_header(const char *headers, const char *name)
 {
-    // initial json
-    const cJSON *data = NULL;
+    size_t name_len = strlen(name);
+    const char *line = strstr(headers, "\r\n");
+
+    // the first line is the status line, headers start after it
+    while(line != NULL && strncmp(line, "\r\n\r\n", 4) != 0) {
+        line += 2;
+        if(!strncasecmp(line, name, name_len) && line[name_len] == ':') {
+            line += name_len + 1;
+            while(*line == ' ') {
+                line++;
+            }
+            return line;
+        }
+        line = strstr(line, "\r\n");
+    }
 
-    // conditions object
-    const cJSON *condition = NULL;
-    const cJSON *conditions = NULL;
+    return NULL;
+}
 
-    // subsets of conditions
-    const cJSON *am = NULL;
-    const cJSON *rating = NULL;
-    const cJSON *maxHeight = NULL;
-    const cJSON *minHeight = NULL;
-    
-    const char *error_ptr = NULL;
+/* copies a header value found by find_header into dest, dest is left empty
+   if the header is missing or doesn't fit */
+static void copy_header(char *dest, size_t dest_len, const char *value)
+{
+    size_t len = 0;
 
-    Rating r;
+    dest[0] = '\0';
+    if(value == NULL) {
+        return;
+    }
 
-    // time value
-    struct tm tm;
-    struct tm *adjusted;
-    time_t t;
+    len = strcspn(value, "\r\n");
+    if(len >= dest_len) {
+        return;
+    }
+    memcpy(dest, value, len);
+    dest[len] = '\0';
+}
 
-    // instead of using an NTP server get time date from HTTP header
-    char *content = strstr(recv_buf, "Date: ");
+/* parses an HTTP date like the one in the Date or Expires header, returns
+   -1 if value is NULL or can't be parsed */
+static time_t parse_http_date(const char *value)
+{
+    struct tm tm = {0};
+
+    if(value == NULL || strptime(value, "%a, %d %b %Y %H:%M:%S", &tm) == NULL)
+    {
+        return -1;
+    }
+    return mktime(&tm);
+}
 
-    // move past "Date: "
-    content += 6;
+/* instead of using an NTP server the time comes from the HTTP Date header,
+   the tick count it arrived at keeps the clock going between polls */
+static time_t clock_time;
+static TickType_t clock_tick;
 
-    if(content)
+/* sets the clock from the Date header of a response */
+static void set_clock(const char *headers)
+{
+    const char *content = find_header(headers, "Date");
+    time_t t = parse_http_date(content);
+
+    if(t == -1)
     {
-        ESP_LOGI(T, "%s\n", content);
-        // parse for time data
-        if (strptime(content, "%a, %d %b %Y %H:%M:%S", &tm) == NULL)
-        {
-            ESP_LOGI(T, "Could not parse time from HTTP header");
-        }
+        ESP_LOGI(T, "Could not parse time from HTTP header");
+        return;
     }
+    ESP_LOGI(T, "%.29s\n", content);
+    clock_time = t;
+    clock_tick = xTaskGetTickCount();
+}
+
+/* fills in time with the adjusted local time and returns it */
+static struct tm *get_time(struct tm *time)
+{
+    time_t t = clock_time + (xTaskGetTickCount() - clock_tick) * portTICK_PERIOD_MS / 1000;
 
-    t = mktime(&tm);
     t -= 25200;
-    adjusted = localtime(&t);
+    return localtime_r(&t, time);
+}
 
-    ESP_LOGI(T, "hour: %d; minute: %d; second: %d\n", adjusted->tm_hour, adjusted->tm_min, adjusted->tm_sec);
+/* returns the number of ticks until the minute on the clock changes */
+static int32_t ticks_to_next_minute(void)
+{
+    uint32_t ms = (xTaskGetTickCount() - clock_tick) * portTICK_PERIOD_MS;
+    int32_t sec = (clock_time + ms / 1000) % 60;
+
+    return ((60 - sec) * 1000 - ms % 1000) / portTICK_PERIOD_MS;
+}
+
+/* returns how long the response in headers stays current in ms, going by
+   Cache-Control max-age or else Expires and less the Age it already has.
+   POLL_TIME if the server doesn't say, always within MIN_POLL_TIME and
+   MAX_POLL_TIME */
+static long fresh_time(const char *headers)
+{
+    const char *cache = find_header(headers, "Cache-Control");
+    const char *age = find_header(headers, "Age");
+    time_t expires, date;
+    long fresh = -1;
 
+    // max-age wins over Expires, directives are separated by commas
+    while(cache != NULL && *cache != '\r' && *cache != '\0')
+    {
+        if(!strncasecmp(cache, "max-age=", 8))
+        {
+            fresh = strtol(cache + 8, NULL, 10);
+            break;
+        }
+        cache += strcspn(cache, ",\r");
+        cache += strspn(cache, ", ");
+    }
 
-    /* get rid of the HTTP header */
-    content = strstr(recv_buf, "\r\n\r\n");
+    if(fresh < 0)
+    {
+        expires = parse_http_date(find_header(headers, "Expires"));
+        date = parse_http_date(find_header(headers, "Date"));
+        if(expires != -1 && date != -1)
+        {
+            fresh = expires - date;
+        }
+    }
 
-    ESP_LOGI(T, "Parsing JSON\n");
+    if(fresh < 0)
+    {
+        return POLL_TIME;
+    }
+    if(age != NULL)
+    {
+        fresh -= strtol(age, NULL, 10);
+    }
 
-    if (content != NULL) {
-        content += 4; // Offset by 4 bytes to start of content
+    // clamp in seconds so the conversion to ms can't overflow
+    if(fresh < MIN_POLL_TIME / 1000)
+    {
+        return MIN_POLL_TIME;
     }
-    else {
-        ESP_LOGE(T, "End of Header Not Found\n");
+    if(fresh > MAX_POLL_TIME / 1000)
+    {
+        return MAX_POLL_TIME;
     }
+    return fresh * 1000;
+}
 
-    /* parse the given json */
-    cJSON *json = cJSON_Parse(content);
+/* draws the time on the top half of the OLED, the caller refreshes it */
+void draw_time(struct tm *time)
+{
+    char data_str[16] = {0};
+    sprintf(data_str, "%02d:%02d", time->tm_hour, time->tm_min);
+    ESP_LOGI(T, "%s\n", data_str);
+    ssd1306_draw_3216char(ssd1306_dev, 24, 0, data_str[0]);
+    ssd1306_draw_3216char(ssd1306_dev, 40, 0, data_str[1]);
+    ssd1306_draw_3216char(ssd1306_dev, 56, 0, data_str[2]);
+    ssd1306_draw_3216char(ssd1306_dev, 72, 0, data_str[3]);
+    ssd1306_draw_3216char(ssd1306_dev, 88, 0, data_str[4]);
+    shown_time = time->tm_hour * 60 + time->tm_min;
+}
 
-    /* check for invalid JSON response */
-    if (json == NULL)
+/* brings the time on the OLED up to date without touching the rating, the
+   display is left alone if the minute hasn't changed */
+void show_time(struct tm *time)
+{
+    if(shown_time == time->tm_hour * 60 + time->tm_min)
     {
-        ESP_LOGE(T, "\tError With First Parse\n");
-        error_ptr = cJSON_GetErrorPtr();
-        if (error_ptr != NULL)
-        {
-            ESP_LOGE(T, "%s\n", error_ptr);
-        }
-        cJSON_Delete(json);
         return;
     }
+    draw_time(time);
+    ssd1306_refresh_gram(ssd1306_dev);
+}
+
+/* updates the LED strip and OLED with a complete morning report */
+void show_report(Report *report)
+{
+    Rating r;
 
-    // get data portion from JSON
-    data = cJSON_GetObjectItemCaseSensitive(json, "data");
+    // log values to console
+    ESP_LOGI(T, "Wave Height: %d-%d ft\n", 
+        report->min_height, 
+        report->max_height);
 
-    // get conditions portion of JSON
-    conditions = cJSON_GetObjectItemCaseSensitive(data, "conditions");
+    ESP_LOGI(T, "\tRating: %s\n", report->rating);
 
-    // different conditions requires this
-    cJSON_ArrayForEach(condition, conditions)
+    r = calculate_rating(report->rating);
+
+    r.num_leds = report->max_height;
+    if(r.num_leds > CONFIG_EXAMPLE_STRIP_LED_NUMBER)
     {
-        // get the morning condition report
-        am = cJSON_GetObjectItemCaseSensitive(condition, "am");
+        r.num_leds = CONFIG_EXAMPLE_STRIP_LED_NUMBER;
+    }
+    update_led_strip(report->strip, r);
 
-        // get the morning rating
-        rating = cJSON_GetObjectItemCaseSensitive(am, "rating");
+    ssd1306_clear_screen(ssd1306_dev, 0x00);
+    draw_time(&report->time);
 
-        // check and make sure it is a valid rating
-        if (!cJSON_IsString(rating))
+    char rating_str[16] = {0};
+    for(int i = 0; i < strlen(report->rating); i++)
+    {
+        if(report->rating[i] == '_')
+        {
+            rating_str[i] = ' ';
+        }
+        else
         {
-            ESP_LOGE(T, "\tWrong Rating\n");
-            error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr != NULL)
+            rating_str[i] = report->rating[i];
+        }
+    }
+    int center_val = 32;
+    if(strlen(rating_str) == 12)
+    {
+        center_val = 16;
+    }
+    ssd1306_draw_string(ssd1306_dev, center_val, 40, (const uint8_t *)rating_str, 16, 1);
+    ssd1306_refresh_gram(ssd1306_dev);
+    report->shown = esp_timer_get_time();
+}
+
+/* called by the stream parser for every value in PATHS */
+static void handle_report(void *user_data, int path_index, const cJSON *item)
+{
+    Report *report = (Report *)user_data;
+
+    switch(path_index)
+    {
+        case RATING_PATH:
+            // check and make sure it is a valid rating
+            if (!cJSON_IsString(item))
             {
-                ESP_LOGE(T, "%s\n", error_ptr);
+                ESP_LOGE(T, "\tWrong Rating\n");
+                return;
             }
-            cJSON_Delete(json);
-            return;
-        }
+            strncpy(report->rating, cJSON_GetStringValue(item), sizeof(report->rating) - 1);
+            report->rating[sizeof(report->rating) - 1] = '\0';
+            report->found |= FOUND_RATING;
+            break;
+
+        case MAX_HEIGHT_PATH:
+            // make sure maximum height is valid
+            if (!cJSON_IsNumber(item))
+            {
+                ESP_LOGE(T, "\tWrong Max Height\n");
+                return;
+            }
+            report->max_height = cJSON_GetIntValue(item);
+            report->found |= FOUND_MAX_HEIGHT;
+            break;
 
-        // get maximum wave height
-        maxHeight = cJSON_GetObjectItemCaseSensitive(am, "maxHeight");
+        case MIN_HEIGHT_PATH:
+            // make sure minimum height is valid
+            if (!cJSON_IsNumber(item))
+            {
+                ESP_LOGE(T, "\tWrong Min Height\n");
+                return;
+            }
+            report->min_height = cJSON_GetIntValue(item);
+            report->found |= FOUND_MIN_HEIGHT;
+            break;
 
-        // make sure maximum height is valid
-        if (!cJSON_IsNumber(maxHeight))
-        {
-            ESP_LOGE(T, "\tWrong Max Height\n");
-            error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr != NULL)
+        case AM_PATH:
+            // the morning report is done, only show it if it is complete
+            if (report->found == FOUND_ALL && report->strip != NULL)
+            {
+                show_report(report);
+            }
+            else if (report->found == FOUND_ALL)
+            {
+                ESP_LOGI(T, "%s: %s %d-%d ft\n", report->spot->name,
+                    report->rating, report->min_height, report->max_height);
+            }
+            else
             {
-                ESP_LOGE(T, "%s\n", error_ptr);
+                ESP_LOGE(T, "\tIncomplete Report\n");
             }
-            cJSON_Delete(json);
-            return;
+            report->found = 0;
+            break;
+    }
+}
+
+/* where the chunked decoder is in the framing around the chunk data */
+enum chunk_states {
+    CHUNK_SIZE,     // hex size of the next chunk
+    CHUNK_EXT,      // chunk extension after the size, ignored
+    CHUNK_DATA,     // chunk_left bytes of data
+    CHUNK_DATA_END, // CRLF behind the data
+    CHUNK_TRAILER,  // trailer lines after the last chunk
+};
+
+/* where the gzip decoder is in the gzip member, see RFC 1952 */
+enum gzip_states {
+    GZIP_HEADER,    // fixed 10 byte header
+    GZIP_EXTRA_LEN, // length of the FEXTRA field
+    GZIP_EXTRA,     // FEXTRA field, skipped
+    GZIP_NAME,      // null terminated FNAME, skipped
+    GZIP_COMMENT,   // null terminated FCOMMENT, skipped
+    GZIP_HCRC,      // header CRC16, skipped
+    GZIP_DEFLATE,   // compressed data
+    GZIP_TRAILER,   // CRC32 and ISIZE, skipped as TCP already checks the data
+                    // and the inflater may have read into it already
+};
+
+// flags in the fourth byte of the gzip header
+#define GZIP_FHCRC      0x02
+#define GZIP_FEXTRA     0x04
+#define GZIP_FNAME      0x08
+#define GZIP_FCOMMENT   0x10
+
+/* decodes the body of a response on its way from the socket to the JSON
+   parser, taking off the chunked framing first and then the gzip encoding */
+typedef struct Body {
+    int chunked;
+    int chunk_state;
+    long chunk_left;
+    int chunk_line;     // length of the current trailer line
+
+    int gzip;
+    int gzip_state;
+    int gzip_flags;
+    int gzip_left;      // bytes left in the current field
+    int gzip_extra;     // length of the FEXTRA field
+    tinfl_decompressor *inflator;   // borrowed from the shared inflater
+    uint8_t *dict;      // TINFL_LZ_DICT_SIZE of inflated output, wraps around
+    size_t dict_ofs;
+
+    int done;           // the end of the body was found in the stream
+    cJSON_Stream *stream;
+} Body;
+
+/* hands decoded body bytes to the JSON parser, returns -1 if they are not
+   valid JSON */
+static int feed_json(Body *body, const char *data, size_t len)
+{
+    if(!cJSON_FeedStream(body->stream, data, len)) {
+        ESP_LOGE(T, "\tInvalid JSON at byte %d\n", (int)body->stream->offset);
+        return -1;
+    }
+    return 0;
+}
+
+/* runs len bytes of the compressed data through the inflater into the JSON
+   parser, returns the number of bytes consumed or -1 on error. Everything is
+   consumed unless the end of the deflate stream is reached */
+static int inflate_body(Body *body, const uint8_t *data, size_t len)
+{
+    size_t used = 0;
+
+    while(1) {
+        size_t in_bytes = len - used;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - body->dict_ofs;
+        tinfl_status status = tinfl_decompress(body->inflator,
+            data + used, &in_bytes,
+            body->dict, body->dict + body->dict_ofs, &out_bytes,
+            TINFL_FLAG_HAS_MORE_INPUT);
+
+        used += in_bytes;
+        if(out_bytes > 0 && feed_json(body, (const char *)body->dict + body->dict_ofs, out_bytes) < 0) {
+            return -1;
         }
+        body->dict_ofs = (body->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
 
-        // get minimum height
-        minHeight = cJSON_GetObjectItemCaseSensitive(am, "minHeight");
+        if(status == TINFL_STATUS_DONE) {
+            body->gzip_state = GZIP_TRAILER;
+            body->gzip_left = 8;
+            return used;
+        }
+        if(status < 0) {
+            ESP_LOGE(T, "... inflate failed status=%d", status);
+            return -1;
+        }
+        // more output waiting in the inflater even though the input is gone
+        if(status != TINFL_STATUS_HAS_MORE_OUTPUT && used == len) {
+            return used;
+        }
+    }
+}
 
-        // make sure minimum height is valid
-        if (!cJSON_IsNumber(minHeight))
-        {
-            ESP_LOGE(T, "\tWrong Min Height\n");
-            error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr != NULL)
-            {
-                ESP_LOGE(T, "%s\n", error_ptr);
+/* takes the gzip member apart, only the compressed data reaches the JSON
+   parser. Returns -1 on error */
+static int gunzip_body(Body *body, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    while(i < len) {
+        uint8_t c = data[i];
+
+        switch(body->gzip_state) {
+            case GZIP_HEADER:
+                // magic number, deflate method and flags, the rest is ignored
+                if((body->gzip_left == 10 && c != 0x1f) ||
+                   (body->gzip_left == 9 && c != 0x8b) ||
+                   (body->gzip_left == 8 && c != 8)) {
+                    ESP_LOGE(T, "... body is not gzip");
+                    return -1;
+                }
+                if(body->gzip_left == 7) {
+                    body->gzip_flags = c;
+                }
+                i++;
+                if(--body->gzip_left == 0) {
+                    body->gzip_state = GZIP_EXTRA_LEN;
+                    body->gzip_left = 2;
+                }
+                break;
+
+            case GZIP_EXTRA_LEN:
+                if(!(body->gzip_flags & GZIP_FEXTRA)) {
+                    body->gzip_state = GZIP_NAME;
+                    break;
+                }
+                // little endian, the low byte comes first
+                if(body->gzip_left == 2) {
+                    body->gzip_extra = c;
+                }
+                else {
+                    body->gzip_extra |= c << 8;
+                }
+                i++;
+                if(--body->gzip_left == 0) {
+                    body->gzip_state = GZIP_EXTRA;
+                    body->gzip_left = body->gzip_extra;
+                }
+                break;
+
+            case GZIP_EXTRA:
+                if(body->gzip_left == 0) {
+                    body->gzip_state = GZIP_NAME;
+                    break;
+                }
+                i++;
+                body->gzip_left--;
+                break;
+
+            case GZIP_NAME:
+            case GZIP_COMMENT:
+                if(!(body->gzip_flags & (body->gzip_state == GZIP_NAME ? GZIP_FNAME : GZIP_FCOMMENT)) ||
+                   data[i++] == '\0') {
+                    body->gzip_state++;
+                    body->gzip_left = 2;
+                }
+                break;
+
+            case GZIP_HCRC:
+                if(!(body->gzip_flags & GZIP_FHCRC) || body->gzip_left == 0) {
+                    body->gzip_state = GZIP_DEFLATE;
+                    break;
+                }
+                i++;
+                body->gzip_left--;
+                break;
+
+            case GZIP_DEFLATE: {
+                int used = inflate_body(body, data + i, len - i);
+                if(used < 0) {
+                    return -1;
+                }
+                i += used;
+                break;
             }
-            cJSON_Delete(json);
-            return;
+
+            case GZIP_TRAILER:
+                if(body->gzip_left == 0) {
+                    ESP_LOGE(T, "... data after the end of the gzip body");
+                    return -1;
+                }
+                i++;
+                body->gzip_left--;
+                break;
         }
+    }
 
-        // log values to console
-        ESP_LOGI(T, "Wave Height: %d-%d ft\n", 
-            minHeight->valueint, 
-            maxHeight->valueint);
+    return 0;
+}
 
-        ESP_LOGI(T, "\tRating: %s\n", rating->valuestring);
+/* passes a piece of the body with the transfer encoding removed on through
+   the content encoding, returns -1 on error */
+static int decode_body(Body *body, const char *data, size_t len)
+{
+    if(body->gzip) {
+        return gunzip_body(body, (const uint8_t *)data, len);
+    }
+    return feed_json(body, data, len);
+}
 
-        if(rating)
-        {
-            r = calculate_rating(rating->valuestring);
+/* takes the chunked framing off a piece of the body, sets body->done once the
+   last chunk and its trailer have gone by. Returns -1 on error */
+static int dechunk_body(Body *body, const char *data, size_t len)
+{
+    size_t i = 0;
+
+    while(i < len && !body->done) {
+        char c = data[i];
+
+        switch(body->chunk_state) {
+            case CHUNK_SIZE:
+            case CHUNK_EXT:
+                i++;
+                if(c == '\n') {
+                    body->chunk_state = body->chunk_left > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+                    body->chunk_line = 0;
+                }
+                else if(body->chunk_state == CHUNK_EXT || c == '\r') {
+                    // extensions and the line ending carry nothing we need
+                }
+                else if(c == ';' || c == ' ' || c == '\t') {
+                    body->chunk_state = CHUNK_EXT;
+                }
+                else if(isxdigit((unsigned char)c) && body->chunk_left < 0x1000000) {
+                    body->chunk_left = body->chunk_left * 16 +
+                        (isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+                }
+                else {
+                    ESP_LOGE(T, "... bad chunk size");
+                    return -1;
+                }
+                break;
+
+            case CHUNK_DATA: {
+                size_t n = len - i;
+                if(n > body->chunk_left) {
+                    n = body->chunk_left;
+                }
+                if(decode_body(body, data + i, n) < 0) {
+                    return -1;
+                }
+                i += n;
+                body->chunk_left -= n;
+                if(body->chunk_left == 0) {
+                    body->chunk_state = CHUNK_DATA_END;
+                }
+                break;
+            }
+
+            case CHUNK_DATA_END:
+                i++;
+                if(c == '\n') {
+                    body->chunk_state = CHUNK_SIZE;
+                }
+                else if(c != '\r') {
+                    ESP_LOGE(T, "... missing CRLF after chunk");
+                    return -1;
+                }
+                break;
+
+            case CHUNK_TRAILER:
+                // trailer fields are ignored, an empty line ends the body
+                i++;
+                if(c == '\n') {
+                    body->done = (body->chunk_line == 0);
+                    body->chunk_line = 0;
+                }
+                else if(c != '\r') {
+                    body->chunk_line++;
+                }
+                break;
         }
+    }
 
-        r.num_leds = maxHeight->valueint;
-        if(r.num_leds > CONFIG_EXAMPLE_STRIP_LED_NUMBER)
-        {
-            r.num_leds = CONFIG_EXAMPLE_STRIP_LED_NUMBER;
+    return 0;
+}
+
+/* feeds a piece of the body as it came off the socket to the JSON parser */
+static int feed_body(Body *body, const char *data, size_t len)
+{
+    if(body->chunked) {
+        return dechunk_body(body, data, len);
+    }
+    return decode_body(body, data, len);
+}
+
+/* sets up body for the encodings named in the header. A gzip body is only
+   accepted if the request asked for it, which means it holds the shared
+   inflater. Returns -1 if an encoding isn't supported */
+static int init_body(Body *body, const char *headers, cJSON_Stream *stream,
+    tinfl_decompressor *inflator, uint8_t *dict)
+{
+    const char *transfer = find_header(headers, "Transfer-Encoding");
+    const char *content = find_header(headers, "Content-Encoding");
+
+    memset(body, 0, sizeof(*body));
+    body->stream = stream;
+
+    if(transfer != NULL) {
+        if(strncasecmp(transfer, "chunked", 7) != 0) {
+            ESP_LOGE(T, "... unsupported Transfer-Encoding");
+            return -1;
         }
-        update_led_strip((led_strip_t *)strip, r);
-
-        char data_str[16] = {0};
-        sprintf(data_str, "%02d:%02d", adjusted->tm_hour, adjusted->tm_min);
-        ESP_LOGI(T, "%s\n", data_str);
-        ssd1306_clear_screen(ssd1306_dev, 0x00);
-        ssd1306_draw_3216char(ssd1306_dev, 24, 0, data_str[0]);
-        ssd1306_draw_3216char(ssd1306_dev, 40, 0, data_str[1]);
-        ssd1306_draw_3216char(ssd1306_dev, 56, 0, data_str[2]);
-        ssd1306_draw_3216char(ssd1306_dev, 72, 0, data_str[3]);
-        ssd1306_draw_3216char(ssd1306_dev, 88, 0, data_str[4]);
-
-        char rating_str[16] = {0};
-        for(int i = 0; i < strlen(rating->valuestring); i++)
-        {
-            if(rating->valuestring[i] == '_')
-            {
-                rating->valuestring[i] = ' ';
-            }
+        body->chunked = 1;
+        body->chunk_state = CHUNK_SIZE;
+    }
+
+    if(content != NULL && strncasecmp(content, "identity", 8) != 0) {
+        if(strncasecmp(content, "gzip", 4) != 0) {
+            ESP_LOGE(T, "... unsupported Content-Encoding");
+            return -1;
         }
-        sprintf(rating_str, "%s", rating->valuestring);
-        int center_val = 32;
-        if(strlen(rating->valuestring) == 12)
-        {
-            center_val = 16;
+        if(inflator == NULL) {
+            ESP_LOGE(T, "... gzip body that wasn't asked for");
+            return -1;
         }
-        ssd1306_draw_string(ssd1306_dev, center_val, 40, (const uint8_t *)rating_str, 16, 1);
-        ssd1306_refresh_gram(ssd1306_dev);
+        body->inflator = inflator;
+        body->dict = dict;
+        tinfl_init(body->inflator);
+        body->gzip = 1;
+        body->gzip_state = GZIP_HEADER;
+        body->gzip_left = 10;
     }
 
-    // clear all old JSON values
-    cJSON_Delete(json);
-    return;
+    return 0;
+}
 
+/* returns whether the whole body has been decoded, the framing of a chunked
+   body has to be complete and a gzip body has to reach the end of its
+   compressed data */
+static int body_complete(Body *body)
+{
+    if(body->chunked && !body->done) {
+        return 0;
+    }
+    return !body->gzip || body->gzip_state == GZIP_TRAILER;
 }
 
-static void get_surline_data(void *strip)
+/* lets go of the inflater of a gzip body, it stays with the fetch */
+static void free_body(Body *body)
+{
+    body->inflator = NULL;
+    body->dict = NULL;
+}
+
+/* where the request to a spot is */
+enum fetch_states {
+    FETCH_IDLE,         // waiting for the next poll, the socket may be kept alive
+    FETCH_CONNECTING,   // non-blocking connect in progress
+    FETCH_SENDING,      // request going out
+    FETCH_HEADER,       // reading the response header
+    FETCH_BODY,         // streaming the body into the JSON parser
+};
+
+/* points in a poll whose latency is logged, in the order they happen */
+enum stages {
+    STAGE_DNS,          // server address known
+    STAGE_CONNECT,      // connection made
+    STAGE_FIRST_BYTE,   // first byte of the response
+    STAGE_PARSED,       // whole body parsed
+    STAGE_SHOWN,        // on the LED strip and OLED, before the body is done
+    STAGE_COUNT,
+};
+
+static const char *STAGES[] = {"dns", "connect", "first byte", "parsed", "shown"};
+
+/* everything needed to keep a request to one spot in flight next to the
+   others on a non-blocking socket */
+typedef struct Fetch {
+    const Spot *spot;
+    int s;
+    int state;
+    int reused;             // the request went out on a kept alive connection
+    int keep_alive;         // the connection can be reused after the response
+    char buf[BUFFER_SIZE];  // the request, then the header, then the body
+    int len;                // bytes of the request or the header in buf
+    int sent;               // bytes of the request already sent
+    long content_length;
+    long body_len;
+    TickType_t deadline;    // the socket times out if nothing happens by then
+    TickType_t next_poll;   // when the next request goes out
+    long poll_time;         // ms the response stays current
+    int failures;           // errors in a row, the retries back off
+    int64_t start;          // esp_timer_get_time() when the poll started
+    int64_t stages[STAGE_COUNT];    // and at each stage, 0 if not reached
+    Body body;
+    cJSON_Stream stream;
+    Report report;
+
+    /* validators of the forecast that was last parsed, sent back so the
+       server can answer with 304 Not Modified while it hasn't changed */
+    char etag[VALIDATOR_SIZE];
+    char last_modified[VALIDATOR_SIZE];
+    // validators of the response being parsed, kept once it is complete
+    char new_etag[VALIDATOR_SIZE];
+    char new_last_modified[VALIDATOR_SIZE];
+} Fetch;
+
+// kept out of the task stack, only used by the request task
+static Fetch fetches[SPOT_COUNT];
+
+/* Inflating a gzip body takes the tinfl state (about 11 KB) and a 32 KB
+   dictionary. One set for every fetch in flight would need SPOT_COUNT times
+   that, so all spots share this one: only the request of the fetch that
+   holds it asks for gzip, the others take their body uncompressed. The heap
+   used for inflating is never more than these ~43 KB, and they are only
+   allocated while a fetch holds them. If they can't be allocated the
+   request goes out without gzip as well */
+static struct {
+    Fetch *owner;       // NULL while no request asked for gzip
+    tinfl_decompressor *inflator;
+    uint8_t *dict;
+} inflater;
+
+/* hands the inflater to f unless another fetch holds it, returns whether f
+   holds it and may ask for gzip */
+static int claim_inflater(Fetch *f)
+{
+    if(inflater.owner != NULL) {
+        return inflater.owner == f;
+    }
+
+    inflater.inflator = malloc(sizeof(tinfl_decompressor));
+    inflater.dict = malloc(TINFL_LZ_DICT_SIZE);
+    if(inflater.inflator == NULL || inflater.dict == NULL) {
+        ESP_LOGW(T, "... no memory to inflate, asking for an uncompressed body");
+        free(inflater.inflator);
+        free(inflater.dict);
+        inflater.inflator = NULL;
+        inflater.dict = NULL;
+        return 0;
+    }
+    inflater.owner = f;
+
+    return 1;
+}
+
+/* frees the inflater once the poll of the fetch holding it is over */
+static void release_inflater(Fetch *f)
+{
+    if(inflater.owner != f) {
+        return;
+    }
+    free(inflater.inflator);
+    free(inflater.dict);
+    inflater.inflator = NULL;
+    inflater.dict = NULL;
+    inflater.owner = NULL;
+}
+
+/* writes the request for the spot's forecast into f->buf, asking the server
+   to skip the body if the last forecast is still current. Returns the
+   length of the request or -1 if it doesn't fit */
+static int build_request(Fetch *f)
+{
+    int len = sizeof(f->buf);
+    int n = snprintf(f->buf, len, REQUEST, f->spot->id);
+
+    if(n < len && claim_inflater(f)) {
+        n += snprintf(f->buf + n, len - n, "Accept-Encoding: gzip\r\n");
+    }
+    if(f->etag[0] != '\0' && n < len) {
+        n += snprintf(f->buf + n, len - n, "If-None-Match: %s\r\n", f->etag);
+    }
+    if(f->last_modified[0] != '\0' && n < len) {
+        n += snprintf(f->buf + n, len - n, "If-Modified-Since: %s\r\n", f->last_modified);
+    }
+    if(n < len) {
+        n += snprintf(f->buf + n, len - n, "\r\n");
+    }
+
+    return n < len ? n : -1;
+}
+
+/* notes the time a stage of the poll was reached */
+static void mark_stage(Fetch *f, int stage)
+{
+    f->stages[stage] = esp_timer_get_time();
+}
+
+/* logs the time from the start of the poll to every stage it reached, a
+   kept alive connection skips DNS and connect */
+static void log_latency(Fetch *f)
+{
+    char line[96] = "";
+    int n = 0;
+
+    for(int i = 0; i < STAGE_COUNT && n < sizeof(line); i++) {
+        if(f->stages[i] != 0) {
+            n += snprintf(line + n, sizeof(line) - n, " %s %d ms",
+                STAGES[i], (int)((f->stages[i] - f->start) / 1000));
+        }
+    }
+    ESP_LOGI(T, "%s latency:%s", f->spot->name, line);
+}
+
+/* checks that the whole body made it into the JSON parser once the end of
+   the response has been reached, returns one of the RESPONSE_ results */
+static int end_response(Fetch *f)
+{
+    if(f->content_length >= 0 && f->body_len < f->content_length) {
+        ESP_LOGE(T, "... connection closed after %ld of %ld body bytes",
+            f->body_len, f->content_length);
+        return RESPONSE_ERROR;
+    }
+    if(!body_complete(&f->body)) {
+        ESP_LOGE(T, "... connection closed before the end of the body");
+        return RESPONSE_ERROR;
+    }
+
+    if(!cJSON_FinishStream(&f->stream)) {
+        ESP_LOGE(T, "\tIncomplete JSON\n");
+        return RESPONSE_ERROR;
+    }
+    mark_stage(f, STAGE_PARSED);
+
+    // only a forecast that was parsed may be skipped next time
+    strcpy(f->etag, f->new_etag);
+    strcpy(f->last_modified, f->new_last_modified);
+
+    return RESPONSE_OK;
+}
+
+/* feeds len bytes of the body as they came off the socket to the JSON
+   parser. The response ends once the body given by Content-Length or the
+   last chunk has arrived, there is no need to wait for the server to close
+   the connection. Returns one of the RESPONSE_ results */
+static int feed_response(Fetch *f, char *data, int len)
+{
+    // never hand the parser more than Content-Length promised
+    if(f->content_length >= 0 && f->body_len + len > f->content_length) {
+        len = f->content_length - f->body_len;
+    }
+
+    if(len > 0 && feed_body(&f->body, data, len) < 0) {
+        return RESPONSE_ERROR;
+    }
+    f->body_len += len;
+
+    if(f->body.done || (f->content_length >= 0 && f->body_len >= f->content_length)) {
+        return end_response(f);
+    }
+    return RESPONSE_MORE;
+}
+
+/* reads whatever the socket has of the response header into f->buf, which
+   has to hold the whole header. Once it is complete the body is set up and
+   whatever came in behind the header is fed to it. Returns one of the
+   RESPONSE_ results */
+static int receive_header(Fetch *f)
+{
+    int r;
+    char *start = NULL;
+    const char *length_str = NULL;
+    const char *connection = NULL;
+    const char *status_str = NULL;
+    int status = 0;
+
+    // leave room for the null terminator
+    if(f->len >= sizeof(f->buf) - 1) {
+        ESP_LOGE(T, "... header does not fit in %d byte buffer", (int)sizeof(f->buf));
+        return RESPONSE_ERROR;
+    }
+    r = read(f->s, f->buf + f->len, sizeof(f->buf) - 1 - f->len);
+    if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return RESPONSE_MORE;
+    }
+    if(f->len == 0 && (r == 0 || (r < 0 && errno == ECONNRESET))) {
+        return RESPONSE_CLOSED;
+    }
+    if(r < 0) {
+        ESP_LOGE(T, "... socket read failed errno=%d", errno);
+        return RESPONSE_ERROR;
+    }
+    if(r == 0) {
+        ESP_LOGE(T, "... connection closed before end of header");
+        return RESPONSE_ERROR;
+    }
+    if(f->len == 0) {
+        mark_stage(f, STAGE_FIRST_BYTE);
+    }
+    f->len += r;
+    f->buf[f->len] = '\0';
+    start = strstr(f->buf, "\r\n\r\n");
+    if(start == NULL) {
+        return RESPONSE_MORE;
+    }
+    start += 4;
+
+    status_str = strchr(f->buf, ' ');
+    if(status_str != NULL) {
+        status = atoi(status_str + 1);
+    }
+
+    f->content_length = -1;
+    f->body_len = 0;
+    length_str = find_header(f->buf, "Content-Length");
+    // the length of a chunked body is given by its chunks alone
+    if(length_str != NULL && find_header(f->buf, "Transfer-Encoding") == NULL) {
+        f->content_length = strtol(length_str, NULL, 10);
+    }
+
+    // HTTP/1.1 keeps the connection open unless told otherwise, but only a
+    // body with a known length leaves it in a usable state
+    connection = find_header(f->buf, "Connection");
+    f->keep_alive = (length_str != NULL || status == 304 ||
+            find_header(f->buf, "Transfer-Encoding") != NULL) &&
+        !strncmp(f->buf, "HTTP/1.1", 8) &&
+        (connection == NULL || strncasecmp(connection, "close", 5) != 0);
+
+    set_clock(f->buf);
+    get_time(&f->report.time);
+    f->poll_time = fresh_time(f->buf);
+    ESP_LOGI(T, "%s hour: %d; minute: %d; second: %d\n", f->spot->name,
+        f->report.time.tm_hour, f->report.time.tm_min, f->report.time.tm_sec);
+
+    // the forecast is still current, only the clock moves on
+    if(status == 304) {
+        ESP_LOGI(T, "%s forecast not modified, skipping parse\n", f->spot->name);
+        mark_stage(f, STAGE_PARSED);
+        if(f->report.strip != NULL) {
+            show_time(&f->report.time);
+            mark_stage(f, STAGE_SHOWN);
+        }
+        return RESPONSE_OK;
+    }
+    if(status != 200) {
+        ESP_LOGE(T, "... server responded with status %d", status);
+        return RESPONSE_ERROR;
+    }
+
+    if(init_body(&f->body, f->buf, &f->stream,
+        inflater.owner == f ? inflater.inflator : NULL, inflater.dict) < 0) {
+        return RESPONSE_ERROR;
+    }
+
+    // the body overwrites the header, keep the validators until it is parsed
+    copy_header(f->new_etag, sizeof(f->new_etag), find_header(f->buf, "ETag"));
+    copy_header(f->new_last_modified, sizeof(f->new_last_modified), find_header(f->buf, "Last-Modified"));
+
+    ESP_LOGI(T, "Parsing JSON for %s\n", f->spot->name);
+    f->report.found = 0;
+    cJSON_InitStream(&f->stream, PATHS, sizeof(PATHS) / sizeof(PATHS[0]), handle_report, &f->report);
+
+    f->state = FETCH_BODY;
+    return feed_response(f, start, (f->buf + f->len) - start);
+}
+
+/* reads whatever the socket has of the body through f->buf into the JSON
+   parser, a server closing the connection ends the body. Returns one of the
+   RESPONSE_ results */
+static int receive_body(Fetch *f)
+{
+    int r = read(f->s, f->buf, sizeof(f->buf));
+
+    if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return RESPONSE_MORE;
+    }
+    if(r < 0) {
+        ESP_LOGE(T, "... socket read failed errno=%d", errno);
+        return RESPONSE_ERROR;
+    }
+    if(r == 0) {
+        // server closed the connection so everything has been sent
+        return end_response(f);
+    }
+    return feed_response(f, f->buf, r);
+}
+
+/* last address the server resolved to, lwIP doesn't hand out the TTL of
+   the DNS record so it is kept for DNS_CACHE_TTL */
+static struct {
+    struct sockaddr_in addr;
+    TickType_t expires;
+    int valid;
+} dns_cache;
+
+/* marks the cached address as stale so the next connection looks it up again,
+   it is still used if that lookup fails */
+static void expire_dns_cache(void)
+{
+    dns_cache.expires = xTaskGetTickCount();
+}
+
+/* fills in addr with the server's address, straight from the cache while it
+   is fresh. If a lookup fails the last good address is used and the lookup
+   is only retried after DNS_RETRY_TIME. Returns 0 on success or -1 if no
+   address is known at all */
+static int resolve_server(struct sockaddr_in *addr)
 {
     const struct addrinfo hints = {
         .ai_family = AF_INET,
         .ai_socktype = SOCK_STREAM,
     };
     struct addrinfo *res;
-    struct in_addr *addr;
-    int s, r;
-    char recv_buf[BUFFER_SIZE];
-    while(1) {
-        int err = getaddrinfo(WEB_SERVER, WEB_PORT, &hints, &res);
 
-        if(err != 0 || res == NULL) {
+    // cast to signed so the comparison survives the tick counter wrapping
+    if(dns_cache.valid && (int32_t)(xTaskGetTickCount() - dns_cache.expires) < 0) {
+        *addr = dns_cache.addr;
+        return 0;
+    }
+
+    int err = getaddrinfo(WEB_SERVER, WEB_PORT, &hints, &res);
+
+    if(err != 0 || res == NULL) {
+        if(!dns_cache.valid) {
             ESP_LOGE(T, "DNS lookup failed err=%d res=%p", err, res);
-            vTaskDelay(DELAY_TIME / portTICK_PERIOD_MS);
-            continue;
+            return -1;
         }
+        ESP_LOGW(T, "DNS lookup failed err=%d, using last address", err);
+        dns_cache.expires = xTaskGetTickCount() + DNS_RETRY_TIME / portTICK_PERIOD_MS;
+        *addr = dns_cache.addr;
+        return 0;
+    }
 
-        /* Code to print the resolved IP.
-            Note: inet_ntoa is non-reentrant, look at ipaddr_ntoa_r for "real" code */
-        addr = &((struct sockaddr_in *)res->ai_addr)->sin_addr;
-        ESP_LOGI(T, "DNS lookup succeeded. IP=%s", inet_ntoa(*addr));
+    memcpy(&dns_cache.addr, res->ai_addr, sizeof(dns_cache.addr));
+    dns_cache.expires = xTaskGetTickCount() + DNS_CACHE_TTL / portTICK_PERIOD_MS;
+    dns_cache.valid = 1;
+    freeaddrinfo(res);
 
-        s = socket(res->ai_family, res->ai_socktype, 0);
-        if(s < 0) {
-            ESP_LOGE(T, "... Failed to allocate socket.");
-            freeaddrinfo(res);
-            vTaskDelay(DELAY_TIME / portTICK_PERIOD_MS);
-            continue;
-        }
-        ESP_LOGI(T, "... allocated socket");
+    /* Code to print the resolved IP.
+        Note: inet_ntoa is non-reentrant, look at ipaddr_ntoa_r for "real" code */
+    ESP_LOGI(T, "DNS lookup succeeded. IP=%s", inet_ntoa(dns_cache.addr.sin_addr));
 
-        if(connect(s, res->ai_addr, res->ai_addrlen) != 0) {
-            ESP_LOGE(T, "... socket connect failed errno=%d", errno);
-            close(s);
-            freeaddrinfo(res);
-            vTaskDelay(DELAY_TIME / portTICK_PERIOD_MS);
-            continue;
-        }
+    *addr = dns_cache.addr;
+    return 0;
+}
 
-        ESP_LOGI(T, "... connected");
-        freeaddrinfo(res);
+/* starts a non-blocking connection to the server at addr, returns the
+   socket or -1. The socket turns writable once the connection is made */
+static int connect_to_server(struct sockaddr_in *addr)
+{
+    int s;
 
-        if (write(s, REQUEST, strlen(REQUEST)) < 0) {
-            ESP_LOGE(T, "... socket send failed");
-            close(s);
-            vTaskDelay(DELAY_TIME / portTICK_PERIOD_MS);
-            continue;
+    s = socket(AF_INET, SOCK_STREAM, 0);
+    if(s < 0) {
+        ESP_LOGE(T, "... Failed to allocate socket.");
+        return -1;
+    }
+    ESP_LOGI(T, "... allocated socket");
+
+    if(fcntl(s, F_SETFL, O_NONBLOCK) < 0) {
+        ESP_LOGE(T, "... failed to make socket non-blocking");
+        close(s);
+        return -1;
+    }
+
+    if(connect(s, (struct sockaddr *)addr, sizeof(*addr)) != 0 && errno != EINPROGRESS) {
+        ESP_LOGE(T, "... socket connect failed errno=%d", errno);
+        close(s);
+        // the server may have moved, look it up again next time
+        expire_dns_cache();
+        return -1;
+    }
+
+    return s;
+}
+
+/* closes the socket of f unless the response left it ready for the next
+   request and schedules the next poll for when the forecast goes stale, or
+   sooner after an error */
+static void finish_fetch(Fetch *f, int result)
+{
+    long delay;
+
+    free_body(&f->body);
+    release_inflater(f);
+    if(f->report.shown != 0) {
+        f->stages[STAGE_SHOWN] = f->report.shown;
+    }
+    log_latency(f);
+
+    ESP_LOGI(T, "... done with %s. Result=%d", f->spot->name, result);
+    if(f->s >= 0 && (result != RESPONSE_OK || !f->keep_alive)) {
+        close(f->s);
+        f->s = -1;
+    }
+
+    if(result == RESPONSE_OK) {
+        f->failures = 0;
+        delay = f->poll_time;
+    }
+    else {
+        // back off while the errors keep coming
+        delay = RETRY_TIME;
+        for(int i = 0; i < f->failures && delay < MAX_RETRY_TIME; i++) {
+            delay *= 2;
         }
-        ESP_LOGI(T, "... socket send success");
-
-        struct timeval receiving_timeout;
-        receiving_timeout.tv_sec = 5;
-        receiving_timeout.tv_usec = 0;
-        if (setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &receiving_timeout,
-                sizeof(receiving_timeout)) < 0) {
-            ESP_LOGE(T, "... failed to set socket receiving timeout");
-            close(s);
-            vTaskDelay(DELAY_TIME / portTICK_PERIOD_MS);
-            continue;
+        if(delay > MAX_RETRY_TIME) {
+            delay = MAX_RETRY_TIME;
         }
-        ESP_LOGI(T, "... set socket receiving timeout success");
+        f->failures++;
+    }
+    // spread out the polls of clocks that were started together
+    delay += esp_random() % (delay * POLL_JITTER / 100 + 1);
 
-        // zero out receive buffer for next fill
-        bzero(recv_buf, sizeof(recv_buf));
+    ESP_LOGI(T, "... next poll of %s in %ld s", f->spot->name, delay / 1000);
+    f->state = FETCH_IDLE;
+    f->next_poll = xTaskGetTickCount() + delay / portTICK_PERIOD_MS;
+}
 
-        // wait 5 seconds to make sure the socket has completely recieved the message
-        // realistically this should be a call to recv or something similar
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+/* sends the next request of f, reusing the connection from the last poll if
+   there is one */
+static void start_fetch(Fetch *f)
+{
+    struct sockaddr_in addr;
+
+    f->reused = (f->s >= 0);
+    f->keep_alive = 0;
+    f->poll_time = POLL_TIME;
+    f->sent = 0;
+    f->deadline = xTaskGetTickCount() + SOCKET_TIMEOUT / portTICK_PERIOD_MS;
+    memset(&f->body, 0, sizeof(f->body));
+
+    f->len = build_request(f);
+    if(f->len < 0) {
+        ESP_LOGE(T, "... request does not fit in %d byte buffer", (int)sizeof(f->buf));
+        finish_fetch(f, RESPONSE_ERROR);
+        return;
+    }
 
-        // read from the socket and get data
-        r = read(s, recv_buf, sizeof(recv_buf));
+    if(f->reused) {
+        f->state = FETCH_SENDING;
+        return;
+    }
 
-        // parse the incoming json for data needed
-        parse_json(recv_buf, r, (led_strip_t *)strip);
+    if(resolve_server(&addr) < 0) {
+        finish_fetch(f, RESPONSE_ERROR);
+        return;
+    }
+    mark_stage(f, STAGE_DNS);
 
-        ESP_LOGI(T, "... done reading from socket. Last read return=%d errno=%d.", r, errno);
-        close(s);
+    f->s = connect_to_server(&addr);
+    if(f->s < 0) {
+        finish_fetch(f, RESPONSE_ERROR);
+        return;
+    }
+    f->state = FETCH_CONNECTING;
+}
+
+/* moves f along once select says its socket is ready */
+static void fetch_ready(Fetch *f)
+{
+    int r = RESPONSE_MORE;
+    int sent;
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+
+    switch(f->state) {
+        case FETCH_CONNECTING:
+            if(getsockopt(f->s, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err != 0) {
+                ESP_LOGE(T, "... socket connect failed errno=%d", err);
+                // the server may have moved, look it up again next time
+                expire_dns_cache();
+                r = RESPONSE_ERROR;
+                break;
+            }
+            ESP_LOGI(T, "... connected");
+            mark_stage(f, STAGE_CONNECT);
+            f->state = FETCH_SENDING;
+            // the socket is writable so the request can go out right away
+            /* fall through */
+
+        case FETCH_SENDING:
+            sent = write(f->s, f->buf + f->sent, f->len - f->sent);
+            if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if(sent < 0) {
+                ESP_LOGE(T, "... socket send failed");
+                r = RESPONSE_CLOSED;
+                break;
+            }
+            f->sent += sent;
+            if(f->sent == f->len) {
+                ESP_LOGI(T, "... socket send success");
+                // the response goes into the buffer the request came from
+                f->state = FETCH_HEADER;
+                f->len = 0;
+            }
+            break;
+
+        case FETCH_HEADER:
+            r = receive_header(f);
+            break;
+
+        case FETCH_BODY:
+            r = receive_body(f);
+            break;
+    }
+
+    // nothing is allowed to sit quiet for longer than SOCKET_TIMEOUT
+    f->deadline = xTaskGetTickCount() + SOCKET_TIMEOUT / portTICK_PERIOD_MS;
+
+    if(r == RESPONSE_MORE) {
+        return;
+    }
 
-        // delay until calling again
-        vTaskDelay(DELAY_TIME / portTICK_PERIOD_MS);
+    // the server closed the connection from the last poll in the meantime,
+    // try once more on a fresh one
+    if(r == RESPONSE_CLOSED && f->reused) {
+        ESP_LOGI(T, "... kept alive connection was closed, reconnecting");
+        close(f->s);
+        f->s = -1;
+        start_fetch(f);
+        return;
+    }
+
+    finish_fetch(f, r);
+}
+
+/* keeps the requests to all SPOTS in flight at once from a single task,
+   waiting on all of their sockets with select. In between polls the task
+   only wakes up to move the clock on */
+static void get_surline_data(void *strip)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    for(int i = 0; i < SPOT_COUNT; i++) {
+        fetches[i].spot = &SPOTS[i];
+        fetches[i].s = -1;
+        fetches[i].state = FETCH_IDLE;
+        fetches[i].next_poll = now;
+        fetches[i].report.spot = &SPOTS[i];
+    }
+    // the first spot is the one on the clock
+    fetches[0].report.strip = (led_strip_t *)strip;
+
+    while(1) {
+        fd_set readfds, writefds;
+        struct timeval timeout;
+        int maxfd = -1;
+        int32_t wait = MAX_POLL_TIME / portTICK_PERIOD_MS;
+        struct tm time;
+
+        // the clock on the OLED keeps going between polls once a report is up
+        if(shown_time >= 0) {
+            show_time(get_time(&time));
+            wait = ticks_to_next_minute();
+        }
+
+        FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
+
+        for(int i = 0; i < SPOT_COUNT; i++) {
+            Fetch *f = &fetches[i];
+
+            now = xTaskGetTickCount();
+            // cast to signed so the comparisons survive the tick counter wrapping
+            if(f->state == FETCH_IDLE && (int32_t)(now - f->next_poll) >= 0) {
+                // the latency of a poll includes reconnecting a stale connection
+                f->start = esp_timer_get_time();
+                memset(f->stages, 0, sizeof(f->stages));
+                f->report.shown = 0;
+                start_fetch(f);
+            }
+            else if(f->state != FETCH_IDLE && (int32_t)(now - f->deadline) >= 0) {
+                ESP_LOGE(T, "... %s timed out", f->spot->name);
+                finish_fetch(f, RESPONSE_ERROR);
+            }
+
+            if(f->state == FETCH_IDLE) {
+                if((int32_t)(f->next_poll - now) < wait) {
+                    wait = f->next_poll - now;
+                }
+                continue;
+            }
+
+            FD_SET(f->s, f->state <= FETCH_SENDING ? &writefds : &readfds);
+            if(f->s > maxfd) {
+                maxfd = f->s;
+            }
+            if((int32_t)(f->deadline - now) < wait) {
+                wait = f->deadline - now;
+            }
+        }
+        if(wait < 0) {
+            wait = 0;
+        }
+
+        // nothing in flight, sleep until the next poll
+        if(maxfd < 0) {
+            vTaskDelay(wait);
+            continue;
+        }
+
+        timeout.tv_sec = wait * portTICK_PERIOD_MS / 1000;
+        timeout.tv_usec = (wait * portTICK_PERIOD_MS % 1000) * 1000;
+        if(select(maxfd + 1, &readfds, &writefds, NULL, &timeout) < 0) {
+            ESP_LOGE(T, "... select failed errno=%d", errno);
+            vTaskDelay(SOCKET_TIMEOUT / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        for(int i = 0; i < SPOT_COUNT; i++) {
+            Fetch *f = &fetches[i];
+
+            if(f->state != FETCH_IDLE &&
+               (FD_ISSET(f->s, &readfds) || FD_ISSET(f->s, &writefds))) {
+                fetch_ready(f);
+            }
+        }
     }
 }
 
@@ -402,4 +1486,4 @@ void init_request(led_strip_t *strip)
 {
     // create the JSON requests task, pass in the led strip pointer for access
     xTaskCreate(&get_surline_data, "get_surline_data", 8192, strip, 5, NULL);
-}
\ No newline at end of file
+}
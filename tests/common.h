@@ -0,0 +1,24 @@
+#ifndef SURF_CLOCK_TESTS_COMMON_H
+#define SURF_CLOCK_TESTS_COMMON_H
+
+/* the tests check static functions of cJSON, so they compile it themselves */
+#include "../main/cJSON.c"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+/* report a failed condition and carry on with the rest of the test */
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            failures++; \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (printf("%s\n", (failures == 0) ? "ok" : "FAILED"), (failures == 0) ? 0 : 1)
+
+#endif
@@ -0,0 +1,194 @@
+/* parse_number takes a shortcut around strtod for short numbers, which has to give the very same double, bit for bit,
+ * and end at the same character. Checked at the edges of the shortcut: 15 to 17 digits, the exact integers around
+ * 2^53, as many decimals as there are exact powers of ten, exponents and -0. */
+
+#include "common.h"
+
+#include <float.h>
+
+/* the first mismatches are printed, the rest only counted */
+#define MAX_REPORTS 10
+
+static int reports = 0;
+
+static void check_number(const char *text)
+{
+    char input[80];
+    parse_buffer buffer;
+    cJSON item;
+    double expected = 0;
+    char *expected_end = NULL;
+
+    /* something after the number, like in a document */
+    sprintf(input, "%.70s,", text);
+    memset(&buffer, 0, sizeof(buffer));
+    memset(&item, 0, sizeof(item));
+    buffer.content = (const unsigned char*)input;
+    buffer.length = strlen(input);
+    buffer.hooks = global_hooks;
+
+    expected = strtod(input, &expected_end);
+    if (!parse_number(&item, &buffer) || (memcmp(&cJSON_ValueDouble(&item), &expected, sizeof(expected)) != 0) || (buffer.offset != (size_t)(expected_end - input)))
+    {
+        failures++;
+        if (reports++ < MAX_REPORTS)
+        {
+            printf("%s: parsed %.17g ending at %u, strtod %.17g ending at %u\n", text, cJSON_ValueDouble(&item), (unsigned)buffer.offset,
+                expected, (unsigned)(expected_end - input));
+        }
+    }
+}
+
+/* digits with a decimal point after each of them and in front of all, with and without a sign */
+static void check_decimals(const char *digits)
+{
+    char text[64];
+    size_t length = strlen(digits);
+    size_t point = 0;
+
+    for (point = 1; point <= length; point++)
+    {
+        sprintf(text, "%.*s", (int)point, digits);
+        if (point < length)
+        {
+            sprintf(text + point, ".%s", digits + point);
+        }
+        check_number(text);
+        text[0] = '-';
+        sprintf(text + 1, "%.*s", (int)point, digits);
+        if (point < length)
+        {
+            sprintf(text + 1 + point, ".%s", digits + point);
+        }
+        check_number(text);
+    }
+    sprintf(text, "0.%s", digits);
+    check_number(text);
+    sprintf(text, "-0.%s", digits);
+    check_number(text);
+}
+
+static void test_long_mantissas(void)
+{
+    static const char *digits[] = {
+        "123456789012345", "999999999999999", "100000000000001", "314159265358979",
+        "1234567890123456", "9999999999999999", "1000000000000001", "3141592653589793",
+        "12345678901234567", "99999999999999999", "10000000000000001", "31415926535897932",
+        "000000000000001", "0000000000000001", "00000000000000001"
+    };
+    size_t i = 0;
+
+    for (i = 0; i < (sizeof(digits) / sizeof(digits[0])); i++)
+    {
+        check_decimals(digits[i]);
+    }
+}
+
+/* the integers a double holds exactly end at 2^53 = 9007199254740992 */
+static void test_powers_of_two(void)
+{
+    static const char *numbers[] = {
+        "9007199254740990", "9007199254740991", "9007199254740992", "9007199254740993", "9007199254740994",
+        "9007199254740995", "900719925474099", "900719925474099.1", "90071992547409.93", "4503599627370495.5",
+        "4503599627370496", "4503599627370497", "0.9007199254740993", "18014398509481985"
+    };
+    size_t i = 0;
+
+    for (i = 0; i < (sizeof(numbers) / sizeof(numbers[0])); i++)
+    {
+        check_number(numbers[i]);
+        check_decimals(numbers[i]);
+    }
+}
+
+/* the shortcut has powers of ten up to 1e15, numbers with more digits or any exponent go to strtod */
+static void test_exponents(void)
+{
+    static const char *numbers[] = {
+        "1e15", "1e16", "1e-15", "1e-16", "1e22", "1e23", "1E2", "1e+2", "1.5e-7", "0.000000000000001",
+        "0.0000000000000001", "100000000000000", "1000000000000000", "999999999999999.9", "0.1", "0.2", "0.3",
+        "1.7976931348623157e308", "2.2250738585072014e-308", "4.9e-324", "1e309", "123456789012345e-15",
+        "12345678901234.5e1"
+    };
+    size_t i = 0;
+
+    for (i = 0; i < (sizeof(numbers) / sizeof(numbers[0])); i++)
+    {
+        check_number(numbers[i]);
+        check_decimals(numbers[i] + ((numbers[i][0] == '-') ? 1 : 0));
+    }
+}
+
+static void test_zeros(void)
+{
+    static const char *numbers[] = { "0", "-0", "0.0", "-0.0", "-0.000000000000000", "-0e0", "0.000", "-00" };
+    size_t i = 0;
+
+    for (i = 0; i < (sizeof(numbers) / sizeof(numbers[0])); i++)
+    {
+        check_number(numbers[i]);
+    }
+}
+
+/* up to 17 random digits with the point anywhere, sometimes an exponent */
+static void test_random_numbers(void)
+{
+    unsigned long seed = 1;
+    char digits[24];
+    char text[48];
+    size_t count = 0;
+    size_t i = 0;
+    int round = 0;
+
+    for (round = 0; round < 100000; round++)
+    {
+        seed = (seed * 1103515245UL) + 12345UL;
+        count = 1 + ((seed >> 16) % 17);
+        for (i = 0; i < count; i++)
+        {
+            seed = (seed * 1103515245UL) + 12345UL;
+            digits[i] = (char)('0' + ((seed >> 16) % 10));
+        }
+        digits[count] = '\0';
+        check_decimals(digits);
+
+        seed = (seed * 1103515245UL) + 12345UL;
+        sprintf(text, "%se%d", digits, (int)((seed >> 16) % 40) - 20);
+        check_number(text);
+    }
+}
+
+/* valueint is the number saturated to an int, whether it is stored or worked out from valuedouble */
+static void test_int_values(void)
+{
+    cJSON *root = cJSON_Parse("[3.7,-3.7,1e300,-1e300,2147483647,-2147483648,true,false,\"7\",null]");
+
+    CHECK(root != NULL);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 0)) == 3);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 1)) == -3);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 2)) == INT_MAX);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 3)) == INT_MIN);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 4)) == 2147483647);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 5)) == INT_MIN);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 6)) == 1);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 7)) == 0);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 8)) == 0);
+    CHECK(cJSON_GetIntValue(cJSON_GetArrayItem(root, 9)) == 0);
+    CHECK(cJSON_GetIntValue(NULL) == 0);
+    CHECK(cJSON_SetNumberValue(cJSON_GetArrayItem(root, 0), 12.5) == 12.5);
+    CHECK(cJSON_ValueInt(cJSON_GetArrayItem(root, 0)) == 12);
+    cJSON_Delete(root);
+}
+
+int main(void)
+{
+    test_long_mantissas();
+    test_powers_of_two();
+    test_exponents();
+    test_zeros();
+    test_random_numbers();
+    test_int_values();
+    CHECK(DBL_MANT_DIG == 53);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,175 @@
+/* The word at a time scanners have to find the same byte as the byte at a time ones for every alignment of the
+ * input, every length (including ends in the middle of a word) and every byte value in every lane of a word. A
+ * word kernel that flags too much only sends the scan to the byte loop early, one that misses a byte skips it. */
+
+#include "common.h"
+
+#define WORD sizeof(unsigned long)
+#define MAX_LENGTH (5 * WORD)
+
+typedef const unsigned char *(*scanner)(const unsigned char *pointer, const unsigned char * const end);
+
+/* room for every offset and length with guard bytes around them, aligned like a word */
+static union
+{
+    unsigned long align;
+    unsigned char bytes[WORD + (2 * MAX_LENGTH) + WORD];
+} storage;
+
+/* compares the word scanner with the byte scanner on length bytes at offset, stops the test on the first mismatch */
+static int same_result(scanner words, scanner bytes, const char *name, size_t offset, size_t length)
+{
+    const unsigned char *start = storage.bytes + WORD + offset;
+    const unsigned char *expected = bytes(start, start + length);
+    const unsigned char *found = words(start, start + length);
+
+    if (found != expected)
+    {
+        failures++;
+        printf("%s: offset %u length %u found %d expected %d\n", name, (unsigned)offset, (unsigned)length,
+            (int)(found - start), (int)(expected - start));
+        return 0;
+    }
+    if ((expected < start) || (expected > (start + length)))
+    {
+        failures++;
+        printf("%s: offset %u length %u result %d out of range\n", name, (unsigned)offset, (unsigned)length,
+            (int)(expected - start));
+        return 0;
+    }
+
+    return 1;
+}
+
+/* fills the buffer with background and the guard bytes with stop, which ends a scan that reads past its end */
+static void fill(unsigned char background, unsigned char stop)
+{
+    memset(storage.bytes, stop, sizeof(storage.bytes));
+    memset(storage.bytes + WORD, background, 2 * MAX_LENGTH);
+}
+
+/* one byte of every value at every position of every aligned and unaligned run, with a background that doesn't
+ * stop the scan and bytes that would stop it right behind the end */
+static void single_bytes(scanner words, scanner bytes, const char *name, const unsigned char *backgrounds, size_t count, unsigned char stop)
+{
+    size_t background = 0;
+    size_t offset = 0;
+    size_t length = 0;
+    size_t position = 0;
+    int value = 0;
+
+    for (background = 0; background < count; background++)
+    {
+        for (offset = 0; offset < (2 * WORD); offset++)
+        {
+            for (length = 0; length <= MAX_LENGTH; length++)
+            {
+                fill(backgrounds[background], stop);
+                if (!same_result(words, bytes, name, offset, length))
+                {
+                    return;
+                }
+                for (position = 0; position < length; position++)
+                {
+                    for (value = 0; value < 256; value++)
+                    {
+                        storage.bytes[WORD + offset + position] = (unsigned char)value;
+                        if (!same_result(words, bytes, name, offset, length))
+                        {
+                            printf("%s: byte 0x%02x at %u on 0x%02x\n", name, value, (unsigned)position, backgrounds[background]);
+                            return;
+                        }
+                    }
+                    storage.bytes[WORD + offset + position] = backgrounds[background];
+                }
+            }
+        }
+    }
+}
+
+/* every pair of byte values in two lanes of one word, which catches carries from one lane into the next */
+static void byte_pairs(scanner words, scanner bytes, const char *name, unsigned char background)
+{
+    size_t offset = 0;
+    size_t first = 0;
+    size_t second = 0;
+    int a = 0;
+    int b = 0;
+
+    for (offset = 0; offset < WORD; offset += WORD - 1)
+    {
+        for (first = 0; first < WORD; first++)
+        {
+            for (second = first + 1; second < WORD; second++)
+            {
+                fill(background, background);
+                for (a = 0; a < 256; a++)
+                {
+                    for (b = 0; b < 256; b++)
+                    {
+                        storage.bytes[WORD + offset + first] = (unsigned char)a;
+                        storage.bytes[WORD + offset + second] = (unsigned char)b;
+                        if (!same_result(words, bytes, name, offset, 2 * WORD))
+                        {
+                            printf("%s: bytes 0x%02x 0x%02x at %u and %u\n", name, a, b, (unsigned)first, (unsigned)second);
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* random JSON-ish runs at random offsets and lengths */
+static void random_runs(void)
+{
+    static const unsigned char alphabet[] = " \t\r\n\"\\a{}[]:,0\x7f\x80\xa2\xdc\xff";
+    unsigned long seed = 1;
+    size_t offset = 0;
+    size_t length = 0;
+    size_t i = 0;
+    int round = 0;
+
+    for (round = 0; round < 200000; round++)
+    {
+        seed = (seed * 1103515245UL) + 12345UL;
+        offset = (seed >> 8) % (2 * WORD);
+        length = (seed >> 16) % (MAX_LENGTH + 1);
+        for (i = 0; i < sizeof(storage.bytes); i++)
+        {
+            seed = (seed * 1103515245UL) + 12345UL;
+            /* mostly one kind of byte so the runs get long */
+            storage.bytes[i] = ((seed >> 16) % 8 == 0) ? alphabet[(seed >> 20) % (sizeof(alphabet) - 1)] : (((round & 1) != 0) ? ' ' : 'a');
+        }
+        if (!same_result(scan_whitespace, scan_whitespace_bytes, "scan_whitespace", offset, length) ||
+            !same_result(scan_string, scan_string_bytes, "scan_string", offset, length))
+        {
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    /* everything up to 32 counts as whitespace */
+    static const unsigned char whitespace[] = { ' ', '\t', '\r', '\n', '\0', 0x1f };
+    /* bytes next to '"' (0x22) and '\\' (0x5c), and with the high bit set */
+    static const unsigned char content[] = { 'a', 0x21, 0x23, 0x5b, 0x5d, 0xa2, 0xdc, 0x80, 0xff, '\0' };
+
+    printf("%u byte words%s\n", (unsigned)WORD,
+#ifdef CJSON_SCALAR_SCAN
+        ", built with CJSON_SCALAR_SCAN"
+#else
+        ""
+#endif
+        );
+
+    single_bytes(scan_whitespace, scan_whitespace_bytes, "scan_whitespace", whitespace, sizeof(whitespace), 'x');
+    single_bytes(scan_string, scan_string_bytes, "scan_string", content, sizeof(content), '\"');
+    byte_pairs(scan_whitespace, scan_whitespace_bytes, "scan_whitespace", ' ');
+    byte_pairs(scan_string, scan_string_bytes, "scan_string", 'a');
+    random_runs();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,111 @@
+/* cJSON_PrintToSink has to print everything through a window that cJSON_Print can, and the same text. Strings are
+ * the edge case: one that fits the window is printed in one go, a longer one in pieces, and the lengths right at the
+ * size of the window have to end up on one side or the other. */
+
+#include "common.h"
+
+/* room for everything the sink is handed */
+#define OUTPUT_SIZE 4096
+
+typedef struct
+{
+    char text[OUTPUT_SIZE];
+    size_t length;
+    size_t window_size;
+} collected;
+
+static cJSON_bool CJSON_CDECL collect(void *user_data, const char *data, size_t length)
+{
+    collected *output = (collected*)user_data;
+
+    if ((length > output->window_size) || ((output->length + length) >= sizeof(output->text)))
+    {
+        return false;
+    }
+    memcpy(output->text + output->length, data, length);
+    output->length += length;
+    output->text[output->length] = '\0';
+
+    return true;
+}
+
+/* prints item through windows of window_size bytes and compares that with cJSON_Print */
+static void check_print(const cJSON *item, size_t window_size, cJSON_bool format, const char *description, size_t string_length)
+{
+    char window[512];
+    collected output;
+    char *expected = format ? cJSON_Print(item) : cJSON_PrintUnformatted(item);
+
+    output.length = 0;
+    output.text[0] = '\0';
+    output.window_size = window_size;
+    if (!cJSON_PrintToSink(item, format, window, window_size, collect, &output) || (expected == NULL) || (strcmp(output.text, expected) != 0))
+    {
+        failures++;
+        printf("%s of %u bytes through a %u byte window%s: \"%s\"\n", description, (unsigned)string_length, (unsigned)window_size,
+            format ? ", formatted" : "", output.text);
+    }
+    cJSON_free(expected);
+}
+
+/* a string of length bytes, escaped ones too if escapes is set */
+static void fill_string(char *string, size_t length, cJSON_bool escapes)
+{
+    size_t i = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        string[i] = (char)('a' + (i % 26));
+        if (escapes && ((i % 7) == 3))
+        {
+            string[i] = ((i % 2) != 0) ? '\"' : '\n';
+        }
+    }
+    string[length] = '\0';
+}
+
+/* strings from 6 bytes shorter than the window up to a few longer, as a value, in an array and as a key */
+static void test_window_edges(size_t window_size, cJSON_bool escapes)
+{
+    char string[512];
+    cJSON *item = NULL;
+    size_t length = 0;
+    cJSON_bool format = false;
+
+    for (length = window_size - 6; length <= (window_size + 2); length++)
+    {
+        fill_string(string, length, escapes);
+        for (format = false; format <= true; format++)
+        {
+            item = cJSON_CreateString(string);
+            check_print(item, window_size, format, "string", length);
+            cJSON_Delete(item);
+
+            item = cJSON_CreateArray();
+            cJSON_AddItemToArray(item, cJSON_CreateString(string));
+            cJSON_AddItemToArray(item, cJSON_CreateString(string));
+            check_print(item, window_size, format, "array of strings", length);
+            cJSON_Delete(item);
+
+            item = cJSON_CreateObject();
+            cJSON_AddNumberToObject(item, string, 1);
+            cJSON_AddStringToObject(item, "value", string);
+            check_print(item, window_size, format, "key and value", length);
+            cJSON_Delete(item);
+        }
+    }
+}
+
+int main(void)
+{
+    static const size_t window_sizes[] = { 16, 40, 64, 120, 256 };
+    size_t i = 0;
+
+    for (i = 0; i < (sizeof(window_sizes) / sizeof(window_sizes[0])); i++)
+    {
+        test_window_edges(window_sizes[i], false);
+        test_window_edges(window_sizes[i], true);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Collects the per-poll latency lines the clock logs and sums them up.
+
+The clock logs one line per poll and spot, for example
+
+  I (61234) JSON Parser: slo latency: dns 12 ms connect 48 ms first byte 215 ms parsed 240 ms shown 231 ms
+
+with the time from the start of the poll to every stage it reached. This
+script reads those lines from the serial port (needs pyserial), a log file
+or stdin, and prints the count, minimum, median, 90th percentile and
+maximum of every stage. With --serve it starts tools/replay_server.py with
+the given arguments first, so a whole run against a known network is one
+command:
+
+  python3 tools/latency.py --port /dev/cu.SLAB_USBtoUART --polls 20 \\
+      --serve "--port 8080 --latency 200 --jitter 100 --drop 0.05"
+
+The clock has to be built with CONFIG_SURFLINE_SERVER set to this machine
+and CONFIG_SURFLINE_PORT to the server port, see the README.
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+LINE = re.compile(r"JSON Parser: (.+?) latency:(.*)$")
+STAGE = re.compile(r" ([a-z ]+?) (-?\d+) ms")
+COLOR = re.compile(r"\x1b\[[0-9;]*m")
+STAGES = ["dns", "connect", "first byte", "parsed", "shown"]
+
+
+def parse_line(line):
+    """returns (spot, {stage: ms}) for a latency line, None for anything else"""
+    match = LINE.search(COLOR.sub("", line).rstrip())
+    if match is None:
+        return None
+    return match.group(1), {stage: int(ms) for stage, ms in STAGE.findall(match.group(2))}
+
+
+def percentile(values, share):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(share * len(values)))]
+
+
+def summarize(samples):
+    """per stage statistics over all spots"""
+    summary = {}
+    for stage in STAGES:
+        values = [stages[stage] for _, stages in samples if stage in stages]
+        if values:
+            summary[stage] = {
+                "count": len(values),
+                "min": min(values),
+                "p50": percentile(values, 0.5),
+                "p90": percentile(values, 0.9),
+                "max": max(values),
+            }
+    return summary
+
+
+def print_summary(samples, out=sys.stdout):
+    spots = sorted(set(spot for spot, _ in samples))
+    out.write("%d polls of %s\n" % (len(samples), ", ".join(spots) or "no spot"))
+    out.write("%-12s %6s %8s %8s %8s %8s\n" % ("stage", "count", "min ms", "p50 ms", "p90 ms", "max ms"))
+    for stage, s in summarize(samples).items():
+        out.write("%-12s %6d %8d %8d %8d %8d\n" % (stage, s["count"], s["min"], s["p50"], s["p90"], s["max"]))
+
+
+def open_input(options):
+    if options.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("reading the serial port needs pyserial (pip install pyserial)")
+        port = serial.Serial(options.port, options.baud, timeout=1)
+        return (raw.decode("utf-8", "replace") for raw in iter(port.readline, None))
+    if options.log and options.log != "-":
+        return open(options.log, encoding="utf-8", errors="replace")
+    return sys.stdin
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Sum up the poll latency logged by the clock.")
+    parser.add_argument("--port", help="serial port of the clock, needs pyserial")
+    parser.add_argument("--baud", type=int, default=115200, help="baud rate of --port")
+    parser.add_argument("--log", help="read a saved log instead, - for stdin (the default)")
+    parser.add_argument("--polls", type=int, default=0, help="stop after this many latency lines")
+    parser.add_argument("--duration", type=float, default=0, help="stop after this many seconds")
+    parser.add_argument("--serve", metavar="ARGS", help="run tools/replay_server.py with ARGS meanwhile")
+    parser.add_argument("--json", metavar="FILE", help="also write the samples and summary as JSON")
+    parser.add_argument("--echo", action="store_true", help="print every line that is read")
+    options = parser.parse_args(argv)
+
+    server = None
+    if options.serve is not None:
+        script = os.path.join(os.path.dirname(os.path.abspath(__file__)), "replay_server.py")
+        server = subprocess.Popen([sys.executable, script] + shlex.split(options.serve))
+
+    samples = []
+    start = time.time()
+    try:
+        for line in open_input(options):
+            if options.echo:
+                sys.stdout.write(line)
+            sample = parse_line(line)
+            if sample is not None:
+                samples.append(sample)
+                if not options.echo:
+                    sys.stderr.write("%s:%s\n" % (sample[0], "".join(" %s %d" % s for s in sample[1].items())))
+            if options.polls and len(samples) >= options.polls:
+                break
+            if options.duration and time.time() - start >= options.duration:
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if server is not None:
+            server.terminate()
+            server.wait()
+
+    print_summary(samples)
+    if options.json:
+        with open(options.json, "w") as f:
+            json.dump({"samples": [{"spot": spot, "stages": stages} for spot, stages in samples],
+                       "summary": summarize(samples)}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
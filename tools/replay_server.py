@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""Serves recorded Surfline responses to the clock so polls can be tested
+without the real API, and makes the network as bad as asked for.
+
+A request for /kbyg/<...>/<name>?<key>=<id>&... is answered with
+fixtures/<name>/<id>.json, or fixtures/<name>.json if there is no file for
+the id. The clock asks for /kbyg/regions/forecasts/conditions?subregionId=...,
+so fixtures/conditions/<subregionId>.json is served for each of its spots.
+
+Responses carry a Date, an ETag and Cache-Control: max-age like the real
+API, answer If-None-Match with 304 and keep the connection alive. On top of
+that the server can
+
+  --latency/--jitter   wait before answering
+  --drop               close the connection part way through a response
+  --chunked            send the body with chunked framing
+  --gzip               compress the body if the request accepts gzip
+  --oversize           pad the JSON body to a given size
+  --trickle            write the response a few bytes at a time
+
+Run it with the port the clock is configured for (CONFIG_SURFLINE_PORT):
+
+  python3 tools/replay_server.py --port 8080 --latency 200 --drop 0.1
+"""
+
+import argparse
+import gzip
+import hashlib
+import http.server
+import os
+import random
+import socketserver
+import sys
+import time
+import urllib.parse
+
+FIXTURES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures")
+
+
+def find_fixture(root, path, query):
+    """returns the fixture file for a request path or None"""
+    name = path.rstrip("/").rsplit("/", 1)[-1]
+    if not name or name.startswith("."):
+        return None
+    for values in query.values():
+        for value in values:
+            if value.isalnum():
+                candidate = os.path.join(root, name, value + ".json")
+                if os.path.isfile(candidate):
+                    return candidate
+    candidate = os.path.join(root, name + ".json")
+    return candidate if os.path.isfile(candidate) else None
+
+
+def pad_body(body, size):
+    """grows a JSON object to at least size bytes with a member nothing reads"""
+    end = body.rstrip()
+    if len(body) >= size or not end.endswith(b"}"):
+        return body
+    pad = size - len(body) - len(b',"padding":""')
+    return end[:-1] + b',"padding":"' + b"x" * max(pad, 0) + b'"}' + body[len(end):]
+
+
+class ReplayHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "replay/1.0"
+
+    def log_message(self, format, *args):
+        if not self.server.options.quiet:
+            sys.stderr.write("%s %s\n" % (self.address_string(), format % args))
+
+    def do_GET(self):
+        options = self.server.options
+        url = urllib.parse.urlsplit(self.path)
+        fixture = find_fixture(options.fixtures, url.path, urllib.parse.parse_qs(url.query))
+
+        delay = options.latency + random.uniform(0, options.jitter)
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+        if fixture is None:
+            self.respond(404, b'{"message":"no fixture"}', {})
+            return
+
+        with open(fixture, "rb") as f:
+            body = f.read()
+        etag = '"%s"' % hashlib.sha1(body).hexdigest()[:16]
+        headers = {
+            "Content-Type": "application/json; charset=utf-8",
+            "ETag": etag,
+            "Cache-Control": "max-age=%d" % options.max_age,
+        }
+
+        if self.headers.get("If-None-Match") == etag:
+            self.respond(304, b"", headers)
+            return
+
+        if options.oversize:
+            body = pad_body(body, options.oversize)
+        if options.gzip and "gzip" in (self.headers.get("Accept-Encoding") or ""):
+            body = gzip.compress(body)
+            headers["Content-Encoding"] = "gzip"
+        self.respond(200, body, headers)
+
+    def respond(self, status, body, headers):
+        options = self.server.options
+        lines = ["HTTP/1.1 %d %s" % (status, self.responses[status][0]),
+                 "Date: %s" % self.date_time_string(),
+                 "Server: %s" % self.server_version]
+        lines += ["%s: %s" % item for item in headers.items()]
+
+        if status == 304:
+            payload = b""
+        elif options.chunked:
+            lines.append("Transfer-Encoding: chunked")
+            payload = b""
+            for i in range(0, len(body), options.chunk_size):
+                piece = body[i:i + options.chunk_size]
+                payload += b"%x\r\n" % len(piece) + piece + b"\r\n"
+            payload += b"0\r\n\r\n"
+        else:
+            lines.append("Content-Length: %d" % len(body))
+            payload = body
+        response = ("\r\n".join(lines) + "\r\n\r\n").encode("latin-1") + payload
+
+        # the connection goes away somewhere in the response, maybe before a byte of it
+        cut = len(response)
+        if random.random() < options.drop:
+            cut = random.randrange(len(response))
+            self.close_connection = True
+
+        self.log_request(status, len(body))
+        step = options.trickle or cut
+        for i in range(0, cut, step):
+            self.wfile.write(response[i:min(i + step, cut)])
+            self.wfile.flush()
+            if options.trickle and options.trickle_delay:
+                time.sleep(options.trickle_delay / 1000.0)
+        if cut < len(response):
+            self.log_message("dropped after %d of %d bytes", cut, len(response))
+
+
+class ReplayServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, options):
+        self.options = options
+        http.server.HTTPServer.__init__(self, (options.host, options.port), ReplayHandler)
+
+
+def parse_args(argv=None):
+    parser = argparse.ArgumentParser(description="Replay recorded Surfline responses with injected faults.")
+    parser.add_argument("--host", default="0.0.0.0", help="address to listen on (default all)")
+    parser.add_argument("--port", type=int, default=8080, help="port to listen on (default 8080)")
+    parser.add_argument("--fixtures", default=FIXTURES, help="directory of recorded responses")
+    parser.add_argument("--latency", type=float, default=0, help="ms to wait before every response")
+    parser.add_argument("--jitter", type=float, default=0, help="up to this many ms added to --latency")
+    parser.add_argument("--drop", type=float, default=0, help="share of responses cut off part way (0-1)")
+    parser.add_argument("--chunked", action="store_true", help="send bodies with chunked framing")
+    parser.add_argument("--chunk-size", type=int, default=512, help="bytes per chunk with --chunked")
+    parser.add_argument("--gzip", action="store_true", help="gzip bodies of requests that accept it")
+    parser.add_argument("--oversize", type=int, default=0, help="pad JSON bodies to this many bytes")
+    parser.add_argument("--trickle", type=int, default=0, help="write responses this many bytes at a time")
+    parser.add_argument("--trickle-delay", type=float, default=5, help="ms between writes with --trickle")
+    parser.add_argument("--max-age", type=int, default=60, help="Cache-Control max-age in seconds")
+    parser.add_argument("--seed", type=int, help="seed for --drop and --jitter")
+    parser.add_argument("--quiet", action="store_true", help="don't log requests")
+    options = parser.parse_args(argv)
+    if options.chunk_size <= 0:
+        parser.error("--chunk-size must be positive")
+    return options
+
+
+def main(argv=None):
+    options = parse_args(argv)
+    if options.seed is not None:
+        random.seed(options.seed)
+    server = ReplayServer(options)
+    sys.stderr.write("replaying %s on %s:%d\n" % (options.fixtures, options.host, options.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+
+
+if __name__ == "__main__":
+    main()